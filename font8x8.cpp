@@ -5,6 +5,8 @@
 
 /*  LGPL (c) A. Schiffler */
 
+#include "uVGA.h"
+
 unsigned char _vga_font8x8 [] =
 {
 
@@ -3082,3 +3084,5 @@ unsigned char _vga_font8x8 [] =
 
 };
 
+// same glyphs described as a uVGA font
+const uvga_font_t uvga_font8x8 = { _vga_font8x8, NULL, NULL, 0, 255, 8, 8 };
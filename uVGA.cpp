@@ -261,6 +261,71 @@ LED_ON;
 	x1_pin = FTM_channel_to_gpio_pin[hsync_ftm][x1_ftm_channel];
 
 	all_allocated_rows = NULL;
+	sram_l_nb_rows = UVGA_DEFAULT_STAGING_BUFFERS;
+	library_allocated = false;
+	staging_nb_buffers = UVGA_DEFAULT_STAGING_BUFFERS;
+	staging_buffers_set = false;
+	staging_row_line = NULL;
+
+	scanline_callback = NULL;
+	lb_nb_line_buffers = UVGA_DEFAULT_LINE_BUFFERS;
+	lb_group_line = NULL;
+
+	text_cells = NULL;
+	text_dirty = NULL;
+	text_nb_dirty = 0;
+	text_erase_callback = NULL;
+	text_erase_color = 0;
+
+	tm_map = NULL;
+	tm_dirty = NULL;
+
+	dirty_map = NULL;
+
+	raster_op = UVGA_ROP_COPY;
+
+	import_err = NULL;
+	import_w = 0;
+
+	poly_buffer = NULL;
+	poly_buffer_size = 0;
+	poly_buffer_allocated = false;
+
+	sprites = NULL;
+	sprite_order = NULL;
+	sprite_dirty_rects = NULL;
+	nb_sprites_allocated = 0;
+	sprite_nb_dirty_rects = 0;
+
+	term_enabled = false;
+	term_state = 0;
+
+	glyph_cache = NULL;
+	glyph_cache_tiles = NULL;
+	glyph_cache_buckets = NULL;
+	glyph_cache_hits = 0;
+	glyph_cache_misses = 0;
+
+	palette_user_defined = false;
+	palette_lut = NULL;
+	palette_lut_back = NULL;
+	memset(palette, 0, sizeof(palette));
+
+	color_lut = NULL;
+
+	line_offsets_enabled = false;
+	line_offsets_fb_width = 0;
+	line_offsets = NULL;
+
+	canvas_enabled = false;
+	vp_x = 0;
+	vp_y = 0;
+
+	nb_bands = 0;
+
+	zoom_enabled = false;
+	zoom_first_row = 0;
+	zoom_scale = 256;
 
 	end_of_display_line_dma_num_trigger = -1;
 	end_of_vga_image_dma_num_trigger = -1;
@@ -330,6 +395,89 @@ void uVGA::set_static_framebuffer(uint8_t *frame_buffer)
 	all_allocated_rows = frame_buffer;
 }
 
+// ============================================================================
+// produce lines using a callback when UVGA_DMA_LINE_BUFFER is used
+// must be called BEFORE begin()
+// ============================================================================
+void uVGA::set_scanline_callback(uvga_scanline_callback_t callback, int nb_line_buffers)
+{
+	scanline_callback = callback;
+
+	// with a single line buffer, the CPU would write the line being displayed
+	if(nb_line_buffers < 2)
+		nb_line_buffers = 2;
+
+	lb_nb_line_buffers = nb_line_buffers;
+}
+
+// ============================================================================
+// allow horizontal offset of each frame buffer row
+// must be called BEFORE begin()
+// ============================================================================
+void uVGA::enable_line_offsets(int frame_buffer_width)
+{
+	line_offsets_enabled = true;
+	line_offsets_fb_width = frame_buffer_width;
+}
+
+// ============================================================================
+// number of SRAM_L buffers used to display rows located in SRAM_U
+// must be called BEFORE begin()
+// ============================================================================
+void uVGA::set_staging_buffers(int nb_buffers)
+{
+	// with 1 buffer, a row could only be copied during the horizontal blanking preceding its display
+	if(nb_buffers < 2)
+		nb_buffers = 2;
+
+	staging_nb_buffers = nb_buffers;
+	staging_buffers_set = true;
+}
+
+// ============================================================================
+// use a frame buffer larger than the displayed area
+// must be called BEFORE begin()
+// ============================================================================
+void uVGA::set_virtual_canvas(int width, int height)
+{
+	canvas_enabled = true;
+	canvas_w = width;
+	canvas_h = height;
+}
+
+// ============================================================================
+// add a split screen band below the previous ones
+// must be called BEFORE begin()
+// ============================================================================
+int uVGA::add_band(int nb_lines, int repeat_line, uint8_t *buffer, int buffer_width, int buffer_height)
+{
+	uvga_band_t *band;
+
+	if((nb_bands >= UVGA_MAX_BANDS) || (nb_lines < 0) || (repeat_line < 1))
+		return -1;
+
+	band = &bands[nb_bands];
+
+	band->buffer = buffer;
+	band->nb_lines = nb_lines;
+	band->repeat_line = repeat_line;
+	band->width = buffer_width;
+	band->height = buffer_height;
+	band->scroll_x = 0;
+	band->scroll_y = 0;
+
+	return nb_bands++;
+}
+
+// ============================================================================
+// allow runtime vertical zoom
+// must be called BEFORE begin()
+// ============================================================================
+void uVGA::enable_vertical_zoom()
+{
+	zoom_enabled = true;
+}
+
 // ============================================================================
 // disable automatic start of VGA clocks. clocks_start() must be explicitly called
 // to start image production.
@@ -452,6 +600,8 @@ uvga_error_t uVGA::begin(uVGAmodeline *modeline)
 
 	float exact_pxc_base_cnt;
 	int y;
+	int reserved_rows;
+	uint8_t *staging_ring;
 	uvga_error_t ret;
 
 	if(modeline == NULL)
@@ -505,6 +655,33 @@ uvga_error_t uVGA::begin(uVGAmodeline *modeline)
 	img_color_mode = modeline->img_color_mode;
 	complex_mode_ydiv = modeline->repeat_line;
 
+	switch(img_color_mode)
+	{
+		case UVGA_PAL1:
+								fb_bpp_shift = 0;
+								break;
+		case UVGA_PAL2:
+								fb_bpp_shift = 1;
+								break;
+		case UVGA_PAL4:
+								fb_bpp_shift = 2;
+								break;
+		default:
+								fb_bpp_shift = 3;
+								break;
+	}
+
+	fb_bpp = 1 << fb_bpp_shift;
+	fb_pixel_mask = (1 << fb_bpp) - 1;
+
+	// packed pixels cannot be sent by the pixel DMA, rows are expanded in line buffers just before being displayed
+	if(fb_bpp != 8)
+		dma_config_choice = UVGA_DMA_LINE_BUFFER;
+
+	// SRAM_U DMA channels copy whole rows in SRAM_L, they cannot apply line offsets or change the row of a line
+	if((line_offsets_enabled || zoom_enabled) && (dma_config_choice == UVGA_DMA_AUTO))
+		dma_config_choice = UVGA_DMA_LINE_BUFFER;
+
 	scr_w = modeline->htotal;
 	scr_h = modeline->vtotal;
 
@@ -559,12 +736,34 @@ uvga_error_t uVGA::begin(uVGAmodeline *modeline)
 	{
 		case UVGA_DMA_AUTO:
 		case UVGA_DMA_SINGLE:
+		case UVGA_DMA_LINE_BUFFER:
 									pixel_pin_address = (volatile void*)&GPIOD_PDOR;
 									break;
 	}
 
 	fb_width = img_w;
 
+	// with line offsets or virtual canvas, frame buffer rows can be wider than the displayed width
+	if(line_offsets_enabled && (line_offsets_fb_width > fb_width))
+		fb_width = line_offsets_fb_width;
+
+	if(canvas_enabled && (canvas_w > fb_width))
+		fb_width = canvas_w;
+
+	// number of displayed rows. Without virtual canvas, it is also the frame buffer height
+	vp_rows = UVGA_FB_HEIGHT(img_h, complex_mode_ydiv, v_top_margin, v_bottom_margin);
+	vp_x = 0;
+	vp_y = 0;
+	zoom_first_row = 0;
+	zoom_scale = 256;
+
+	// bands have their own buffers and scrolling, they cannot be combined with line offsets or a virtual canvas
+	if((nb_bands > 0) && (line_offsets_enabled || canvas_enabled))
+		return UVGA_INVALID_BAND_LAYOUT;
+
+	// the pixel DMA only sends a part of each row, the black pixel at the end of the row cannot be used
+	dma_partial_rows = line_offsets_enabled || canvas_enabled || (nb_bands > 0);
+
 	switch(img_color_mode)
 	{
 		case UVGA_RGB332:
@@ -572,13 +771,44 @@ uvga_error_t uVGA::begin(uVGAmodeline *modeline)
 								//fb_row_stride = (fb_width + 1 + 15) & 0xFFF0;	// +1 to include a black pixel. then the result is rounded to the next multiple of 16 due to dma constraint
 								fb_row_stride = UVGA_FB_ROW_STRIDE(fb_width);	// +1 to include a black pixel. then the result is rounded to the next multiple of 16 due to dma constraint
 								//fb_height = (img_h + complex_mode_ydiv - 1) / complex_mode_ydiv;
-								fb_height = UVGA_FB_HEIGHT(img_h, complex_mode_ydiv, v_top_margin, v_bottom_margin);
+								//fb_height = UVGA_FB_HEIGHT(img_h, complex_mode_ydiv, v_top_margin, v_bottom_margin);
+								fb_height = (canvas_enabled && (canvas_h > vp_rows)) ? canvas_h : vp_rows;
+
+								// each band has its own buffer
+								if(nb_bands > 0)
+								{
+									if((ret = bands_init()) != UVGA_OK)
+										return ret;
+									break;
+								}
+
+								// line buffer mode has its own memory layout, the frame buffer does not need to be in SRAM_L
+								if(dma_config_choice == UVGA_DMA_LINE_BUFFER)
+								{
+									if((ret = line_buffer_init()) != UVGA_OK)
+										return ret;
+									break;
+								}
+
+								// virtual canvas has its own memory layout, only the SRAM_L buffers must be in SRAM_L
+								if(canvas_enabled)
+								{
+									if((ret = canvas_init()) != UVGA_OK)
+										return ret;
+									break;
+								}
+
+								// allocate all frame buffer rows + sram_l buffers as a single area, sram_l buffers at the beginning
+								sram_l_nb_rows = staging_nb_buffers;
+								library_allocated = (all_allocated_rows == NULL);
+
+								// a static frame buffer has 1 SRAM_L row (UVGA_FB_SIZE()) unless set_staging_buffers() was called (UVGA_STAGED_FB_SIZE())
+								reserved_rows = (library_allocated || staging_buffers_set) ? staging_nb_buffers : 1;
 
-								// allocate all frame buffer rows + sram_l buffer as a single area, sram_l buffer at the beginning
 								if(all_allocated_rows == NULL)
 								{
 									//all_allocated_rows = (uint8_t*) malloc(fb_row_stride * (fb_height + 1) + 15);
-									all_allocated_rows = (uint8_t*) malloc(UVGA_FB_SIZE(fb_width, img_h, complex_mode_ydiv, v_top_margin, v_bottom_margin));
+									all_allocated_rows = (uint8_t*) malloc(UVGA_STAGED_FB_SIZE(fb_width, img_h, complex_mode_ydiv, v_top_margin, v_bottom_margin, reserved_rows));
 									if(all_allocated_rows == NULL)
 										return UVGA_FAIL_TO_ALLOCATE_FRAME_BUFFER;
 								}
@@ -586,21 +816,24 @@ uvga_error_t uVGA::begin(uVGAmodeline *modeline)
 								// round lines address to multiple of 16 bytes due to DMA burst constraint
 								//all_allocated_rows_aligned = (uint8_t *)(((int)all_allocated_rows + 15) & ~0xF);
 								all_allocated_rows_aligned = UVGA_BUFFER_START(all_allocated_rows);
-								memset(all_allocated_rows_aligned, 0, fb_row_stride * (fb_height + 1));
+								memset(all_allocated_rows_aligned, 0, fb_row_stride * (fb_height + reserved_rows));
 
-								// allocate a 2 lines buffer in SRAM_L must be 16 bytes aligned due to DMA burst copy
+								// SRAM_L buffers must be 16 bytes aligned due to DMA burst copy
 								sram_l_dma_address = all_allocated_rows_aligned;
 
-								if(((int)sram_l_dma_address) >= SRAM_U_START_ADDRESS)
-									return UVGA_FAIL_TO_ALLOCATE_SRAM_L_BUFFER_IN_SRAM_L;
-
-								// frame buffer has a reduced size
+								// frame buffer rows are after SRAM_L buffers
 								//frame_buffer = all_allocated_rows_aligned + fb_row_stride;
-								frame_buffer = UVGA_FB_START(all_allocated_rows_aligned, fb_row_stride);
+								frame_buffer = UVGA_STAGED_FB_START(all_allocated_rows_aligned, fb_row_stride, reserved_rows);
 
-								if(((int)frame_buffer) >= SRAM_U_START_ADDRESS)
+								// without staging (UVGA_DMA_SINGLE), the pixel DMA reads rows directly, the first one must be in SRAM_L
+								if((dma_config_choice != UVGA_DMA_AUTO) && (((int)frame_buffer) >= SRAM_U_START_ADDRESS))
 									return UVGA_FRAME_BUFFER_FIRST_LINE_NOT_IN_SRAM_L;
 
+								// a SRAM_L buffer receives a whole row, including the black pixel
+								canvas_slack = 0;
+								staging_copy_size = fb_row_stride;
+								staging_slot_stride = fb_row_stride;
+
 								img_h_no_margin = img_h - v_top_margin - v_bottom_margin;
 
 								// but not the frame buffer row pointer because it is used to display line
@@ -608,86 +841,63 @@ uvga_error_t uVGA::begin(uVGAmodeline *modeline)
 								if(fb_row_pointer == NULL)
 									return UVGA_FAIL_TO_ALLOCATE_ROW_POINTER_ARRAY;
 
-								sram_u_dma_required = false;
+								layout_compute_row_pointers();
 
-								switch(dma_config_choice)
-								{
-									case UVGA_DMA_AUTO:
-																for(y = 0; y < img_h_no_margin; y++)
-																{
-																	// prevent compiler to convert
-																	//   floor(y / complex_mode_ydiv) * fb_row_stride
-																	// into
-																	//   floor(y * fb_row_stride / complex_mode_ydiv)
-																	// using explicite parenthesis and cast.... just in case it has a stupid idea
-																	// Note: yes, it is possible to write this faster but who cares, it is called only 1 time
-																	fb_row_pointer[y] = frame_buffer + ((int)(y / complex_mode_ydiv)) * fb_row_stride;
-
-																	// check if the last byte of the line is not in SRAM_U
-																	if(((((int)fb_row_pointer[y]) + fb_width - 1) >= SRAM_U_START_ADDRESS) && (sram_u_dma_required == false))
-																	{
-																		DPRINT("y SRAM_U: ");
-																		DPRINTLN(y);
-																		sram_u_dma_required = true;
-																		first_line_in_sram_u = y;
-																	}
-																}
-																break;
-
-									case UVGA_DMA_SINGLE:
-																for(y = 0; y < img_h_no_margin; y++)
-																{
-																	// prevent compiler to convert
-																	//   floor(y / complex_mode_ydiv) * fb_row_stride
-																	// into
-																	//   floor(y * fb_row_stride / complex_mode_ydiv)
-																	// using explicite parenthesis and cast.... just in case it has a stupid idea
-																	// Note: yes, it is possible to write this faster but who cares, it is called only 1 time
-																	fb_row_pointer[y] = frame_buffer + ((int)(y / complex_mode_ydiv)) * fb_row_stride;
-																}
-																break;
-								}
+								sram_u_dma_required = false;
 
-								// if frame buffer lines are in SRAM_U, allocate a DMA redirection array
-								if(sram_u_dma_required == true)
+								// with UVGA_DMA_AUTO, rows in SRAM_U are copied in SRAM_L buffers. With UVGA_DMA_SINGLE, the pixel DMA reads all rows directly
+								if(dma_config_choice == UVGA_DMA_AUTO)
 								{
-									dma_row_pointer = (uint8_t **) malloc(sizeof(uint8_t *) * (img_h_no_margin + complex_mode_ydiv));
-
-									if(dma_row_pointer == NULL)
-										return UVGA_FAIL_TO_ALLOCATE_DMA_ROW_POINTER_ARRAY;
-
-									// row pointer of the line after the last line is the row pointer of the first line
-									// (required to optimize TCD of the 3rd channel, instead of 1 per sram_l_dma_address change, only 1 globally)
 									for(y = 0; y < img_h_no_margin; y++)
 									{
-										dma_row_pointer[y] = fb_row_pointer[y];
-
-										if(((int)dma_row_pointer[y] + fb_width - 1) >= SRAM_U_START_ADDRESS)
+										// check if the last byte of the line is not in SRAM_U
+										if(staging_line_is_staged(y) && (sram_u_dma_required == false))
 										{
+											DPRINT("y SRAM_U: ");
+											DPRINTLN(y);
 											sram_u_dma_required = true;
-											// 2 cases. If the previous line is the same as the current, reuse the same sram_l buffer
-											// else use the other one
-											if(fb_row_pointer[y] == fb_row_pointer[y - 1])
-											{
-												dma_row_pointer[y] = dma_row_pointer[y - 1];
-											}
-											else
-											{
-												dma_row_pointer[y] = sram_l_dma_address;
-											}
 										}
 									}
+								}
 
-									while(y < (img_h_no_margin + complex_mode_ydiv))
+								// memory placement: if all rows fit in SRAM_L when they start at the beginning of the area, SRAM_L buffers are useless
+								// only possible when the library allocated the area, a static frame buffer keeps the layout of UVGA_FB_START()
+								if(sram_u_dma_required && library_allocated && ((((int)all_allocated_rows_aligned) + fb_row_stride * fb_height - 1) < SRAM_U_START_ADDRESS))
+								{
+									DPRINTLN("all rows moved in SRAM_L");
+									sram_l_nb_rows = 0;
+									frame_buffer = all_allocated_rows_aligned;
+									layout_compute_row_pointers();
+									sram_u_dma_required = false;
+								}
+
+								// a frame buffer declared with UVGA_FB_SIZE() only has 1 SRAM_L row, the ring of staging buffers is allocated apart
+								if(sram_u_dma_required && (reserved_rows < sram_l_nb_rows))
+								{
+									staging_ring = (uint8_t*) malloc(staging_slot_stride * sram_l_nb_rows + 15);
+									if(staging_ring == NULL)
+										return UVGA_FAIL_TO_ALLOCATE_STAGING_BUFFERS;
+
+									sram_l_dma_address = UVGA_BUFFER_START(staging_ring);
+								}
+								else
+									staging_ring = NULL;
+
+								if(sram_u_dma_required)
+								{
+									// all SRAM_L buffers must be in SRAM_L
+									if((((int)sram_l_dma_address) + sram_l_nb_rows * staging_slot_stride - 1) >= SRAM_U_START_ADDRESS)
 									{
-										dma_row_pointer[y++] = dma_row_pointer[0];
+										if(staging_ring != NULL)
+										{
+											free(staging_ring);
+											sram_l_dma_address = all_allocated_rows_aligned;
+										}
+										return UVGA_FAIL_TO_ALLOCATE_SRAM_L_BUFFER_IN_SRAM_L;
 									}
 								}
 								else
 								{
-									sram_u_dma_required = false;
-									dma_row_pointer = NULL;
-
 									for(y = 0; y < img_h_no_margin; y++)
 									{
 										DPRINT(y);
@@ -697,14 +907,35 @@ uvga_error_t uVGA::begin(uVGAmodeline *modeline)
 								}
 								break;
 
+		case UVGA_PAL1:
+		case UVGA_PAL2:
+		case UVGA_PAL4:
+								// packed rows, still rounded to a multiple of 16 to keep the same alignment as RGB332 rows
+								fb_row_stride = UVGA_PACKED_ROW_STRIDE(fb_width, fb_bpp);
+								fb_height = (canvas_enabled && (canvas_h > vp_rows)) ? canvas_h : vp_rows;
+
+								if((ret = palette_init()) != UVGA_OK)
+									return ret;
+
+								if((ret = line_buffer_init()) != UVGA_OK)
+									return ret;
+								break;
+
 		default:
 								return UVGA_UNKNOWN_COLOR_MODE;
 								break;
 	}
 
-	if(frame_buffer == NULL)
+	// in line buffer mode, a scanline callback can replace the frame buffer
+	if((frame_buffer == NULL) && (scanline_callback == NULL))
 		return UVGA_FAIL_TO_ALLOCATE_FRAME_BUFFER;
 
+	if(line_offsets_enabled)
+	{
+		if((ret = line_offsets_init()) != UVGA_OK)
+			return ret;
+	}
+
 	// not possible to initialize this earlier
 	init_text_settings();
 
@@ -798,11 +1029,15 @@ void uVGA::signal_pins_init(void)
 
 	switch(img_color_mode)
 	{
+		case UVGA_PAL1:				// palette modes output RGB332 line buffers
+		case UVGA_PAL2:
+		case UVGA_PAL4:
 		case UVGA_RGB332:
 					switch(dma_config_choice)
 					{
 						case UVGA_DMA_AUTO:
 						case UVGA_DMA_SINGLE:
+						case UVGA_DMA_LINE_BUFFER:
 									// vga rgb pin (LSB first): 2,14,7,8,6,20,21,5 (port/bit=D0, D1, D2, D3, D4, D5, D6, D7)
 									GPIOD_PCOR = 0xFF;	// set all pins to LOW
 									pinMode(2, OUTPUT);
@@ -1046,36 +1281,32 @@ uvga_error_t uVGA::dma_init()
 
 	switch(img_color_mode)
 	{
+		case UVGA_PAL1:
+		case UVGA_PAL2:
+		case UVGA_PAL4:
 		case UVGA_RGB332:
-								if(!sram_u_dma_required)
+								// palette modes always use line buffers, the pixel DMA only sees RGB332 lines
+								if(dma_config_choice == UVGA_DMA_LINE_BUFFER)
 								{
-									switch(complex_mode_ydiv)
-									{
-										case 1:
-													ret = rgb332_dma_init_dma_single_repeat_1();
-													break;
-
-										default:
-													ret = rgb332_dma_init_dma_single_repeat_more_than_1();
-													break;
-									}
+									ret = rgb332_dma_init_line_buffer();
+								}
+								else if(sram_u_dma_required)
+								{
+									// rows in SRAM_U are copied in a ring of SRAM_L buffers
+									ret = rgb332_dma_init_dma_staging();
 								}
 								else
 								{
-									switch(complex_mode_ydiv)
+									// with line offsets, virtual canvas or vertical zoom, each line requires its own TCD
+									switch((dma_partial_rows || zoom_enabled) ? 0 : complex_mode_ydiv)
 									{
 										case 1:
-													ret = rgb332_dma_init_dma_multiple_repeat_1();
-													break;
-
-										case 2:
-													ret = rgb332_dma_init_dma_multiple_repeat_2();
+													ret = rgb332_dma_init_dma_single_repeat_1();
 													break;
 
 										default:
-													ret = rgb332_dma_init_dma_multiple_repeat_more_than_2();
+													ret = rgb332_dma_init_dma_single_repeat_more_than_1();
 													break;
-
 									}
 								}
 								break;
@@ -1325,9 +1556,17 @@ void uVGA::stop()
 	{
 		case UVGA_DMA_AUTO:
 		case UVGA_DMA_SINGLE:
+		case UVGA_DMA_LINE_BUFFER:
 									GPIOD_PDDR = 0x00;	// configure all pins of port D as input
 									break;
 	}
+
+	// line buffer mode: stop refilling line buffers
+	if(lb_instance == this)
+	{
+		NVIC_DISABLE_IRQ(IRQ_DMA_CH0 + (dma_num & 0xF));
+		lb_instance = NULL;
+	}
 }
 
 // ============================================================================
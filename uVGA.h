@@ -29,6 +29,8 @@
 
 #include <uVGA_FTM.h>
 #include <uVGA_DMA.h>
+#include <uVGA_rle.h>
+#include <uVGA_image.h>
 
 typedef enum uvga_error_t
 {
@@ -42,6 +44,18 @@ typedef enum uvga_error_t
 	UVGA_FAIL_TO_ALLOCATE_SRAM_L_BUFFER = -7,
 	UVGA_FAIL_TO_ALLOCATE_SRAM_L_BUFFER_IN_SRAM_L = -8,
 	UVGA_UNKNOWN_ERROR = -9,
+	UVGA_INVALID_BAND_LAYOUT = -10,
+	UVGA_FAIL_TO_ALLOCATE_TEXT_GRID = -11,
+	UVGA_FAIL_TO_ALLOCATE_GLYPH_CACHE = -12,
+	UVGA_FAIL_TO_ALLOCATE_SPRITES = -13,
+	UVGA_FAIL_TO_ALLOCATE_TILE_MAP = -14,
+	UVGA_FAIL_TO_ALLOCATE_DIRTY_MAP = -15,
+	UVGA_FAIL_TO_ALLOCATE_IMPORT_BUFFER = -16,
+	UVGA_INVALID_IMAGE = -17,
+	UVGA_FAIL_TO_ALLOCATE_POLYGON_BUFFER = -18,
+	UVGA_FAIL_TO_ALLOCATE_PALETTE_LUT = -19,
+	UVGA_FAIL_TO_ALLOCATE_STAGING_ROW_ARRAY = -20,
+	UVGA_FAIL_TO_ALLOCATE_STAGING_BUFFERS = -21,
 	UVGA_FRAME_BUFFER_FIRST_LINE_NOT_IN_SRAM_L = 10,
 } uvga_error_t;
 
@@ -54,6 +68,12 @@ typedef enum uvga_signal_polarity_t
 typedef enum uvga_color_mode_t
 {
 	UVGA_RGB332,
+
+	// palette indexed modes. Pixels are packed (first pixel in MSB) and colors are index in a RGB332 palette
+	// packed rows are expanded in line buffers just before being displayed (UVGA_DMA_LINE_BUFFER is always used)
+	UVGA_PAL1,				// 1 bit per pixel, 2 colors
+	UVGA_PAL2,				// 2 bits per pixel, 4 colors
+	UVGA_PAL4,				// 4 bits per pixel, 16 colors
 } uvga_color_mode_t;
 
 typedef enum uvga_pixel_hstretch
@@ -70,6 +90,10 @@ typedef enum uvga_dma_settings
 
 	// force library to use only one DMA channel
 	UVGA_DMA_SINGLE,			// RGB signal on GPIO
+
+	// pixel DMA channel reads a small ring of line buffers in SRAM_L.
+	// lines are produced by the CPU just before being displayed (scanline callback or frame buffer copy)
+	UVGA_DMA_LINE_BUFFER,	// RGB signal on GPIO
 } uvga_dma_settings;
 
 typedef enum uvga_text_direction
@@ -80,8 +104,73 @@ typedef enum uvga_text_direction
 	UVGA_DIR_BOTTOM,
 } uvga_text_direction;
 
+// raster operation applied by solid color drawing functions (pixels, lines, shapes, text)
+typedef enum uvga_raster_op
+{
+	UVGA_ROP_COPY,			// pixel = color
+	UVGA_ROP_XOR,			// pixel = pixel ^ color
+	UVGA_ROP_AND,			// pixel = pixel & color
+	UVGA_ROP_OR,			// pixel = pixel | color
+	UVGA_ROP_BLEND50,		// each RGB332 component = (pixel + color) / 2
+	UVGA_ROP_BLEND25,		// each RGB332 component = (3 * pixel + color) / 4
+} uvga_raster_op;
+
+// RGB888/RGB565 to RGB332 conversion of imported images
+typedef enum uvga_dither
+{
+	UVGA_DITHER_NONE,			// nearest color
+	UVGA_DITHER_ORDERED,		// 4x4 Bayer matrix, no state between pixels
+	UVGA_DITHER_DIFFUSION,	// Floyd-Steinberg error diffusion, requires 2 rows of errors
+} uvga_dither;
+
+// polygon fill rule
+typedef enum uvga_fill_rule
+{
+	UVGA_FILL_EVEN_ODD,		// a point is inside if a ray from it crosses an odd number of edges
+	UVGA_FILL_NON_ZERO,		// a point is inside if edges wind around it (self intersecting polygons have no holes)
+} uvga_fill_rule;
+
 #define SRAM_U_START_ADDRESS				0x20000000
 
+// default number of line buffers used by UVGA_DMA_LINE_BUFFER
+#define UVGA_DEFAULT_LINE_BUFFERS		4
+
+// default number of SRAM_L buffers used to display frame buffer rows located in SRAM_U
+#define UVGA_DEFAULT_STAGING_BUFFERS	2
+
+// scanline callback used by UVGA_DMA_LINE_BUFFER
+// it must write the 'width' pixels (RGB332) of frame buffer row 'row' in line_buffer
+// WARNING: it is called from the pixel DMA interrupt, it must be short (less than the duration of a line * (number of line buffers - 1))
+typedef void (*uvga_scanline_callback_t)(uint8_t *line_buffer, int row, int width);
+
+// redraw the background (picture, pattern...) of the w x h pixels area at (x, y) behind a transparent text mode cell
+// it is called by updateTextMode() before the glyph of the cell is drawn
+typedef void (*uvga_text_erase_callback_t)(int x, int y, int w, int h);
+
+// read callback of compressed images streamed from a file or a serial link
+// it must copy at most 'size' bytes in buffer and return their number (0 = end of data)
+typedef int (*uvga_image_read_callback_t)(void *context, uint8_t *buffer, int size);
+
+// size of the buffer used by drawImageStream() on the stack
+#define UVGA_IMAGE_STREAM_BUFFER		256
+
+// maximal number of split screen bands
+#define UVGA_MAX_BANDS					4
+
+// split screen band: a horizontal part of the screen displaying its own buffer
+typedef struct
+{
+	uint8_t *buffer;			// RGB332 rows of the band
+	short first_line;			// first display line of the band (0 = first line after top margin)
+	short nb_lines;			// number of display lines of the band
+	short repeat_line;		// number of times each row of the band is displayed
+	short width;				// width of band rows (at least the displayed width)
+	short height;				// number of rows in buffer (at least nb_lines / repeat_line)
+	short stride;				// number of bytes per row
+	short scroll_x;			// first displayed pixel of each row
+	short scroll_y;			// row displayed on the first line of the band. Rows wrap around
+} uvga_band_t;
+
 typedef enum
 {
 	UVGA_TRIGGER_LOCATION_END_OF_DISPLAY_LINE,	// when Hsync occurs (trigger may be delayed depending on Hsync polarity)
@@ -90,6 +179,104 @@ typedef enum
 	UVGA_TRIGGER_LOCATION_START_OF_DISPLAY_LINE,	// when beam starts a new line (with or without pixel)
 } uvga_trigger_location_t;
 
+// font description
+// each glyph is a block of width x height bits, row after row, MSB first. Rows are not byte aligned, each glyph starts on a byte.
+// with offsets, the rows of a glyph are widths[c] bits long. Without offsets, all glyphs are stored with rows of width bits
+// A fixed width font with 8 pixels wide glyphs is 1 byte per row (same layout as _vga_font8x8)
+typedef struct
+{
+	const uint8_t *bitmap;		// glyphs
+	const uint16_t *offsets;	// offset of each glyph in bitmap, NULL if all glyphs have the same size
+	const uint8_t *widths;		// width (advance) of each glyph in pixels, NULL for fixed width font
+	uint8_t first_char;			// first character of the font
+	uint8_t last_char;			// last character of the font
+	uint8_t width;					// width of the widest glyph (width of all glyphs if widths is NULL)
+	uint8_t height;				// height of all glyphs
+} uvga_font_t;
+
+// maximal number of parameters of a terminal control sequence
+#define UVGA_TERM_MAX_PARAMS			16
+
+// text mode cell attributes
+#define UVGA_TEXT_ATTR_TRANSPARENT	0x01		// background is not drawn
+
+// text mode cell: a character and its colors
+typedef struct
+{
+	uint8_t c;				// character
+	uint8_t fg;				// RGB332 foreground color
+	uint8_t bg;				// RGB332 background color
+	uint8_t attr;			// UVGA_TEXT_ATTR_xxx
+} uvga_text_cell_t;
+
+// glyph cache entry, see setGlyphCache()
+typedef struct
+{
+	const uint8_t *glyph;	// font bitmap of the glyph, NULL if the entry is free
+	uint8_t fg;					// RGB332 foreground color
+	uint8_t bg;					// RGB332 background color
+	short prev;					// LRU list
+	short next;
+	short hash_next;			// next entry with the same hash
+} uvga_glyph_cache_entry_t;
+
+// rectangle, corners included
+typedef struct
+{
+	short x0;
+	short y0;
+	short x1;
+	short y1;
+} uvga_rect_t;
+
+// polygon edge, used by fillPolygon()
+typedef struct uvga_poly_edge_t
+{
+	int32_t x;						// 16.16 position on the current row
+	int32_t dx;						// 16.16 move per row
+	short y_start;					// first and last row
+	short y_end;
+	short winding;					// +1 downward edge, -1 upward edge
+} uvga_poly_edge_t;
+
+// size of the buffer of a polygon of nb_points points
+#define UVGA_POLYGON_BUFFER_SIZE(nb_points)		((nb_points) * (sizeof(uvga_poly_edge_t) + sizeof(uvga_poly_edge_t *)))
+
+// sprite of the sprite engine, see initSprites()
+typedef struct
+{
+	const uint8_t *bitmap;	// bitmap or RLE sprite
+	uint8_t *save;				// backing store: frame buffer area under the sprite (1 byte per pixel)
+	int save_size;
+	short x;
+	short y;
+	short w;
+	short h;
+	short z;						// drawing order
+	short key_color;			// transparent color of bitmap, -1 if none
+	bool rle;					// bitmap is a RLE sprite
+	bool visible;
+	bool modified;				// must be drawn again by updateSprites()
+	bool saved;					// save contains saved_rect area of frame buffer
+	uvga_rect_t saved_rect;
+} uvga_sprite_t;
+
+// memory placement and bus load of the scanout, see get_memory_plan()
+typedef struct
+{
+	uvga_dma_settings dma_mode;		// UVGA_DMA_AUTO = rows in SRAM_U are copied in SRAM_L buffers, UVGA_DMA_SINGLE = all rows are read directly, UVGA_DMA_LINE_BUFFER = line buffers
+	short nb_rows;						// number of frame buffer rows
+	short rows_in_sram_l;			// number of rows entirely in SRAM_L
+	short rows_in_sram_u;			// number of rows (partially) in SRAM_U
+	short first_row_in_sram_u;		// -1 if all rows are in SRAM_L
+	short nb_sram_l_buffers;		// number of SRAM_L buffers (staging buffers or line buffers)
+	short nb_dma_channels;			// number of DMA channels used by the scanout
+	int frame_buffer_bytes;			// frame buffer + SRAM_L buffers
+	int tcd_bytes;						// TCD stored in RAM
+	int sram_l_bytes_per_second;	// bytes read in SRAM_L by the scanout
+	int sram_u_bytes_per_second;	// bytes read in SRAM_U by the scanout (DMA copies, direct DMA reads or line buffer refills)
+} uvga_memory_plan_t;
+
 // to provide value from EDID or Modeline
 typedef struct
 {
@@ -156,6 +343,40 @@ public:
 	// or using 
 	void set_static_framebuffer(uint8_t *frame_buffer);
 
+	// with UVGA_DMA_LINE_BUFFER, produce lines using a callback instead of a frame buffer
+	// if callback is NULL, the frame buffer rows are copied in the line buffers
+	// nb_line_buffers is the number of SRAM_L line buffers (at least 2)
+	// must be called BEFORE begin()
+	void set_scanline_callback(uvga_scanline_callback_t callback, int nb_line_buffers = UVGA_DEFAULT_LINE_BUFFERS);
+
+	// with UVGA_DMA_AUTO, frame buffer rows located in SRAM_U are copied in a ring of nb_buffers SRAM_L buffers before being displayed
+	// nb_buffers is at least 2, so each row is copied while the previous one is displayed. More buffers copy rows further ahead of the beam. A static frame buffer must be allocated using UVGA_STAGED_FB_SIZE() or UVGA_STAGED_CANVAS_SIZE()
+	// must be called BEFORE begin()
+	void set_staging_buffers(int nb_buffers = UVGA_DEFAULT_STAGING_BUFFERS);
+
+	// allow a horizontal offset per frame buffer row (fine horizontal scrolling, parallax) using setLineOffset()
+	// frame_buffer_width is the width of frame buffer rows. If larger than the displayed width, offsets can pan into off-screen pixels
+	// with UVGA_DMA_AUTO, UVGA_DMA_LINE_BUFFER is used
+	// must be called BEFORE begin()
+	void enable_line_offsets(int frame_buffer_width = 0);
+
+	// use a frame buffer (canvas) larger than the displayed area. setViewport() selects the displayed part
+	// all drawing functions use canvas coordinates
+	// must be called BEFORE begin()
+	void set_virtual_canvas(int width, int height);
+
+	// split the screen in horizontal bands, each one displaying its own buffer. Bands are stacked from top to bottom in call order
+	// nb_lines is the number of display lines of the band (0 = all remaining lines, last band only)
+	// buffer_width and buffer_height are the size of the band buffer (0 = displayed width, nb_lines / repeat_line)
+	// if buffer is NULL, it is allocated by begin(). Bands are RGB332 only, return the band number or -1
+	// must be called BEFORE begin()
+	int add_band(int nb_lines, int repeat_line = 1, uint8_t *buffer = NULL, int buffer_width = 0, int buffer_height = 0);
+
+	// allow changing the vertical zoom at runtime using setVerticalZoom()
+	// with UVGA_DMA_AUTO, UVGA_DMA_LINE_BUFFER is used
+	// must be called BEFORE begin()
+	void enable_vertical_zoom();
+
 	// display VGA image
 	uvga_error_t begin(uVGAmodeline *modeline = NULL);
 	void end();
@@ -176,6 +397,10 @@ public:
 	void disable_clocks_autostart();
 	void clocks_start();
 
+	// report memory placement, DMA resources and bus load of the scanout. Can be called after begin(), even if clocks are not started
+	// it describes the placement chosen by begin(), it does not compute a plan before allocation
+	void get_memory_plan(uvga_memory_plan_t *plan);
+
 	// =========================================================
 	// graphic primitives
 	// =========================================================
@@ -194,12 +419,99 @@ public:
 	void fillCircle(int xm, int ym, int r, int color);
 	void drawEllipse(int x0, int y0, int x1, int y1, int color);
 	void fillEllipse(int x0, int y0, int x1, int y1, int color);
+
+	// polygon of nb_points points (x0, y0, x1, y1...), convex, concave or self intersecting. The polygon is closed automatically
+	// edge tables are stored in the polygon buffer: the library buffer grows when required, no allocation is done if the buffer is large enough
+	uvga_error_t fillPolygon(const int16_t *points, int nb_points, int color, uvga_fill_rule rule = UVGA_FILL_EVEN_ODD);
+	// use a caller buffer of size bytes (UVGA_POLYGON_BUFFER_SIZE(max number of points)) or, if buffer is NULL, allocate a library buffer of size bytes
+	uvga_error_t setPolygonBuffer(void *buffer, int size);
 	void scroll(int x, int y, int w, int h, int dx, int dy,int col);
 
+	// raster operation of solid color drawing functions. Bitmaps, sprites, copy and scroll always copy pixels
+	// in palette modes, XOR, AND and OR apply to palette indexes, blends are replaced by COPY
+	void setRasterOp(uvga_raster_op op);
+	uvga_raster_op getRasterOp();
+
+	// horizontal offset of displayed rows, requires enable_line_offsets()
+	// displayed row y shows pixels dx to dx + displayed width - 1 of its frame buffer row. dx is between 0 and frame buffer width - displayed width
+	// without virtual canvas, displayed row y is frame buffer row y
+	void setLineOffset(int y, int dx);						// applied during vertical blanking
+	void setLineOffsets(const int16_t *offsets);		// 1 offset per displayed row, all rows are updated during vertical blanking
+	int getLineOffset(int y);
+
+	// position of the top left displayed pixel in the virtual canvas, requires set_virtual_canvas(). Applied during vertical blanking
+	// when SRAM_U DMA is required, x is rounded down to a multiple of 16
+	void setViewport(int x, int y);
+	void getViewport(int *x, int *y);
+
+	// split screen bands, requires add_band()
+	void selectBand(int band, uint8_t *buffer = NULL);		// drawing functions use band buffer (or 'buffer' with the band geometry)
+	void setBandScroll(int band, int x, int y);			// applied during vertical blanking. y wraps around band rows
+	void setBandBuffer(int band, uint8_t *buffer);			// display another buffer (page flipping), applied during vertical blanking
+	uint8_t *getBandBuffer(int band);
+
+	// vertical zoom, requires enable_vertical_zoom(). Applied during vertical blanking
+	// first_row is the frame buffer row displayed on the first line, scale is in 1/256 (256 = repeat_line of the modeline, 512 = rows twice taller)
+	void setVerticalZoom(int first_row, int scale = 256);
+	void getVerticalZoom(int *first_row, int *scale);
+
 	void copy(int s_x, int s_y, int d_x, int d_y, int w, int h);
 	void drawBitmap(int16_t x_pos, int16_t y_pos, uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height);
+	void drawBitmapKey(int16_t x_pos, int16_t y_pos, const uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height, uint8_t key_color);	// key_color pixels are transparent
+
+	// bitmap resized to width x height (nearest pixel). key_color = -1: no transparent color
+	void drawBitmapScaled(int16_t x_pos, int16_t y_pos, const uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height, int16_t width, int16_t height, int key_color = -1);
+	// bitmap transformed by a 16.16 fixed point matrix giving the bitmap position (u,v) of each frame buffer pixel (x,y)
+	// u = matrix[0] * x + matrix[1] * y + matrix[2], v = matrix[3] * x + matrix[4] * y + matrix[5]
+	void drawBitmapAffine(const uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height, const int32_t *matrix, int key_color = -1);
+	// matrix of drawBitmapAffine(): bitmap point (src_x,src_y) is drawn at (dst_x,dst_y), the bitmap is rotated by angle (radians, clockwise) and scaled around this point
+	static void makeAffineMatrix(int32_t *matrix, float angle, float scale, float src_x, float src_y, float dst_x, float dst_y);
+	void drawSprite(int16_t x_pos, int16_t y_pos, const uint8_t *rle);		// RLE sprite created by uvga_rle_encode()
+
+	// compressed image created by uvga_image_encode(), from memory or read by a callback. clip (NULL = whole frame buffer) limits the modified area
+	uvga_error_t drawImage(int x, int y, const uint8_t *image, int image_size, const uvga_rect_t *clip = NULL);
+	uvga_error_t drawImageStream(int x, int y, uvga_image_read_callback_t read, void *context, const uvga_rect_t *clip = NULL);
+
+	// sprite engine: sprites save and restore the scene under them
+	uvga_error_t initSprites(int nb_sprites);		// 0 frees the sprites
+	uvga_error_t setSprite(int n, const uint8_t *bitmap, int width, int height, int key_color = -1);
+	uvga_error_t setSpriteRLE(int n, const uint8_t *rle);
+	void moveSprite(int n, int x, int y);
+	void showSprite(int n, bool visible = true);
+	void setSpriteZ(int n, int z);					// sprites with higher z are drawn over sprites with lower z
+	void updateSprites();								// wait for vertical blanking, restore the scene and draw sprites at their new position
+	void eraseSprites();									// restore the scene before drawing on it, next updateSprites() draws sprites again
+	int getSpriteDirtyRects(const uvga_rect_t **rects);	// areas modified by the last updateSprites()
+
+	// tile map layer: map of tile_w x tile_h tiles (tile index = 1 byte) displayed in a window of the frame buffer (w or h = -1: up to frame buffer border)
+	uvga_error_t setTileMap(const uint8_t *tiles, int tile_w, int tile_h, uint8_t *map, int map_w, int map_h, int x = 0, int y = 0, int w = -1, int h = -1);
+	void setTile(int column, int row, uint8_t tile);
+	uint8_t getTile(int column, int row);
+	void setTileMapScroll(int x, int y);			// position in the map of the top left pixel of the window, the map wraps around
+	void invalidateTileMap();							// next renderTileMap() draws the whole window
+	void renderTileMap();								// draw tiles modified or scrolled into view since the last call
+	void renderTileMapLine(uint8_t *line_buffer, int row, int width);	// draw a row of the window in a line buffer (scanline callback)
+
+	// dirty region tracking: drawing functions mark the cells (cell_w x cell_h pixels, rounded up to a power of 2) they modify
+	uvga_error_t enableDirtyTracking(int cell_w = 16, int cell_h = 16);
+	void disableDirtyTracking();
+	void markDirty(int x0, int y0, int x1, int y1);	// mark an area modified without the drawing functions (direct frame buffer access)
+	int getDirtyRects(uvga_rect_t *rects, int max_rects, bool clear = true);	// merge dirty cells into at most max_rects rectangles, return their number
+	void clearDirty();
+
+	// streaming image import: rows of width RGB888 or RGB565 pixels are converted and written in frame buffer rows y, y + 1... (RGB332 mode only)
+	uvga_error_t beginImport(int x, int y, int width, uvga_dither dither = UVGA_DITHER_ORDERED);
+	void importRowRGB888(const uint8_t *rgb);		// 3 bytes per pixel: red, green, blue
+	void importRowRGB565(const uint16_t *rgb);
+	void endImport();
 
 	void drawText(const char *text, int x, int y, int fgcol, int bgcol= -1, uvga_text_direction dir = UVGA_DIR_RIGHT);
+	int drawChar(uint8_t c, int x, int y, int fgcol, int bgcol= -1, uvga_text_direction dir = UVGA_DIR_RIGHT);	// return character width
+
+	// font of text functions (NULL = default 8x8 font). Glyphs are magnified by scale. Print window keeps its size in pixels, its number of columns uses the widest glyph
+	void setFont(const uvga_font_t *font, int scale = 1);
+	int charWidth(uint8_t c);
+	int textWidth(const char *text);
 	void moveCursor(int column, int line);
 
 	// define text print window. Width and height are in pixels and cannot be smaller than font width and height
@@ -210,6 +522,32 @@ public:
 
 	void setForegroundColor(uint8_t fg_color);	// RGB332 format
 	void setBackgroundColor(int bg_color);			// RGB332 format or -1 for transparent background
+
+	// text mode: print window content is kept in a cell grid, only modified cells are drawn by updateTextMode()
+	uvga_error_t enableTextMode();					// grid has the size of the current print window, it is recreated each time the print window changes
+	void disableTextMode();
+	void updateTextMode();								// wait for vertical blanking and draw modified cells, call it once per frame
+	void setTextCell(int column, int line, uint8_t c, uint8_t fg_col, int bg_col = -1);
+	void setTextModeErase(uvga_text_erase_callback_t callback, uint8_t color = 0);	// transparent cells are erased by callback (NULL = filled with color) before being redrawn
+
+	// ANSI/VT100 terminal: write() and print() parse escape sequences (cursor, erase, scrolling region, insert/delete, SGR colors)
+	void enableTerminal(bool enable = true);
+
+	// cache of nb_entries glyphs expanded with their colors (font_width * font_height bytes per entry, 0 = no cache). Used by opaque RGB332 text
+	uvga_error_t setGlyphCache(int nb_entries);
+	void getGlyphCacheStats(uint32_t *hits, uint32_t *misses, bool reset = false);
+
+	// palette of UVGA_PAL1, UVGA_PAL2 and UVGA_PAL4 modes (RGB332 format). Can be called before or after begin()
+	void setPalette(const uint8_t *palette, int nb_colors = 16);	// palette contains 2, 4 or 16 colors depending on the color mode
+	void setPaletteColor(int index, uint8_t color);
+	uint8_t getPaletteColor(int index);
+
+	// scanout color lookup table (256 RGB332 => RGB332 entries, NULL to disable). Only used with UVGA_DMA_LINE_BUFFER and palette modes
+	// the table is not copied. In RGB332 mode, it is read each time a line is displayed: its content or the table itself can change at any time
+	// in palette modes, it is merged with the palette: call setColorLut() again after modifying its content
+	void setColorLut(const uint8_t *lut);
+	// fill a color lookup table scaling each color component. brightness is between 0 (black) and 256 (unchanged)
+	static void makeBrightnessLut(uint8_t *lut, int brightness);
 	virtual size_t write(const uint8_t *buffer, size_t size);
 	virtual size_t write(uint8_t c);
 
@@ -313,7 +651,6 @@ private:
 
 	// DMA used to copy frame buffer line in SRAM_U to SRAM_L
 	bool sram_u_dma_required;
-	short first_line_in_sram_u;
 	volatile DMABaseClass::TCD_t *sram_u_dma;				// address of DMA channel registers
 	volatile uint8_t *sram_u_dmamux;				// address of DMA channel multiplexer
 	volatile uint8_t *sram_u_dmaprio;				// address of DMA channel priority
@@ -324,16 +661,28 @@ private:
 	DMABaseClass::TCD_t *sram_u_dma_fix;				// address of DMA channel registers
 	volatile uint8_t *sram_u_dma_fixmux;				// address of DMA channel multiplexer
 	volatile uint8_t *sram_u_dma_fixprio;				// address of DMA channel priority
-	DMABaseClass::TCD_t *sram_u_dma_fix_major_loop;// array of DMA transfer (minor loop) to process to build screen. array MUST BE 32 bytes aligned (eDMA requirement)
 	
 	// to reduce memory usage, all rows (any where in the code) are stored in this array
 	uint8_t *all_allocated_rows;				// it is the real address of all allocated rows
 	uint8_t *all_allocated_rows_aligned;	// this address is 16 bytes aligned
 														// address of all allocated rows (fb_row_stride bytes per row).
-														// its contains fb_height+1 rows. The first one is the SRAM_L buffer.
+														// the first rows are reserved for SRAM_L buffers (1 with UVGA_FB_SIZE(), staging_nb_buffers with UVGA_STAGED_FB_SIZE())
 
 	// SRAM_L buffer
 	uint8_t *sram_l_dma_address;				// address used by DMA
+	short sram_l_nb_rows;						// number of SRAM_L buffers at sram_l_dma_address
+	short staging_nb_buffers;					// requested number of SRAM_L buffers for rows in SRAM_U
+	bool staging_buffers_set;					// true if set_staging_buffers() was called (a static frame buffer has the UVGA_STAGED_FB_SIZE() layout)
+	bool library_allocated;						// true if all_allocated_rows was allocated by begin() (its layout can be chosen freely)
+
+	// line buffer mode (UVGA_DMA_LINE_BUFFER)
+	uvga_scanline_callback_t scanline_callback;	// function producing lines (NULL = copy frame buffer rows)
+	short lb_nb_line_buffers;					// number of line buffers in the SRAM_L ring
+	short lb_row_stride;							// number of bytes per line buffer (always RGB332)
+	short lb_nb_groups;							// number of groups of consecutive display lines showing the same frame buffer row
+	short *lb_group_line;							// first display line of each group. Group g is displayed from line buffer g % lb_nb_line_buffers
+	volatile short lb_next_group;				// next group to render in the ring
+	static uVGA *lb_instance;					// instance served by the pixel DMA interrupt
 
 	// DMA used to perform graphic task
 	volatile DMABaseClass::TCD_t *gfx_dma;				// address of DMA channel registers
@@ -351,13 +700,56 @@ private:
 	short fb_width;
 	short fb_height;
 
+	// pixel format of the frame buffer
+	uint8_t fb_bpp;									// number of bits per pixel (8 = RGB332, 1, 2 or 4 = packed palette index)
+	uint8_t fb_bpp_shift;							// log2(fb_bpp)
+	uint8_t fb_pixel_mask;							// (1 << fb_bpp) - 1
+
+	// palette modes
+	uint8_t palette[16];								// RGB332 color of each palette index
+	bool palette_user_defined;						// if false, begin() loads the default palette of the color mode
+	uint32_t * volatile palette_lut;				// expansion table: 1 packed byte => 8 (1bpp), 4 (2bpp) or 2 (4bpp, uint16_t entries) RGB332 pixels
+	uint32_t *palette_lut_back;					// 2nd expansion table, rebuilt while palette_lut is displayed then swapped with it
+
+	// line offsets
+	bool line_offsets_enabled;
+	short line_offsets_fb_width;				// requested frame buffer width (0 = displayed width)
+	int16_t *line_offsets;						// horizontal offset of each displayed row (NULL = disabled)
+	static uint8_t black_pixel;				// source of the black pixel written by sram_u_dma_fix channel after each line when only a part of rows is displayed
+
+	// virtual canvas and viewport
+	bool canvas_enabled;
+	short canvas_w;								// requested canvas size
+	short canvas_h;
+	short vp_x;										// position of the viewport in the canvas
+	short vp_y;
+	short vp_rows;									// number of displayed rows (frame buffer height without virtual canvas)
+	bool dma_partial_rows;						// true if the pixel DMA only sends the displayed part of frame buffer rows (line offsets, virtual canvas)
+
+	// SRAM_U DMA: staged rows (rows in SRAM_U, every row of a virtual canvas) are copied in one of the sram_l_nb_rows SRAM_L slots before being displayed
+	short canvas_slack;							// number of bytes before the first pixel of each row. Copies start on a 16 bytes boundary and end on the last displayed pixel
+	short staging_copy_size;					// number of bytes copied per row (multiple of 16)
+	short staging_slot_stride;				// size of a slot, the byte after the copied pixels is always black
+	short staging_nb_rows;						// number of staged rows per frame
+	short *staging_row_line;					// first display line of each staged row
+
+	// split screen bands
+	uvga_band_t bands[UVGA_MAX_BANDS];
+	short nb_bands;								// 0 = no band, the whole screen displays the frame buffer
+
+	// vertical zoom
+	bool zoom_enabled;
+	short zoom_first_row;						// frame buffer row displayed on the first line (relative to viewport)
+	short zoom_scale;								// in 1/256, 256 = each row is displayed complex_mode_ydiv times
+
+	// scanout color lookup table
+	const uint8_t * volatile color_lut;			// RGB332 => RGB332 table applied when line buffers are filled (NULL = none)
+
 	uint8_t **fb_row_pointer;					// pointer on start of each line of the frame buffer
 														// array contains fb_height_entries pointing on first pixel off each line
 														// only used in complex color mode
 														// in complex color mode, fb_row_pointer[y] = frame_buffer + z * fb_row_stride, z is between 0 and fb_height
 
-	uint8_t **dma_row_pointer;					// pointer on start of each line used by the DMA
-														// if a line is in SRAM_U and a 2nd DMA 
 	// user DMA triggers
    short end_of_display_line_dma_num_trigger; // channel to start when Hsync occurs (start or end depending on hsync polarity) (-1 = none)
 	short end_of_vga_image_dma_num_trigger;// channel to start after the last pixel of last visible line on screen	 (-1 = none)
@@ -371,6 +763,9 @@ private:
 
 	short cursor_x;			// cursor x position in print window in CHARACTER
 	short cursor_y;			// cursor y position in print window in CHARACTER
+	short cursor_px;			// cursor x position in print window in PIXEL (proportional font)
+	const uvga_font_t *font;
+	short font_scale;
 	short font_width;
 	short font_height;
 	short print_window_x;	// x position in pixel of text window 
@@ -378,18 +773,202 @@ private:
 	short print_window_w;	// text window width in CHARACTER
 	short print_window_h;	// text window height in CHARACTER
 
+	// text mode
+	uvga_text_cell_t *text_cells;		// text_h lines of text_w cells, NULL if text mode is disabled
+	uint32_t *text_dirty;				// 1 bit per displayed cell
+	int text_nb_dirty;
+	short text_w;
+	short text_h;
+	short text_first_line;				// grid line displayed on the first line of the print window
+	uvga_text_erase_callback_t text_erase_callback;	// redraw the background of transparent cells (NULL = filled with text_erase_color)
+	uint8_t text_erase_color;
+
+	// terminal
+	bool term_enabled;
+	uint8_t term_state;
+	bool term_private;
+	short term_nb_params;
+	short term_params[UVGA_TERM_MAX_PARAMS];
+	short term_top;							// scrolling region, in print window lines
+	short term_bottom;
+	short term_saved_x;
+	short term_saved_y;
+	short term_fg;								// -1 = default, 0-15 = ANSI color, 256 + RGB332 color
+	short term_bg;
+	bool term_bold;
+	bool term_reverse;
+	uint8_t term_default_fg;
+	uint8_t term_default_bg;
+	bool term_default_transparent;
+
+	// sprites
+	uvga_sprite_t *sprites;
+	short *sprite_order;						// sprite indexes by increasing z
+	uvga_rect_t *sprite_dirty_rects;
+	short nb_sprites_allocated;
+	short sprite_nb_dirty_rects;
+
+	// tile map
+	const uint8_t *tm_tiles;
+	uint8_t *tm_map;							// NULL if there is no tile map
+	uint32_t *tm_dirty;						// 1 bit per map cell modified by setTile()
+	int tm_nb_dirty;
+	short tm_tile_w;
+	short tm_tile_h;
+	short tm_map_w;
+	short tm_map_h;
+	short tm_x;									// window in frame buffer
+	short tm_y;
+	short tm_w;
+	short tm_h;
+	int tm_sx;									// requested scroll position
+	int tm_sy;
+	int tm_drawn_sx;							// scroll position of the frame buffer content
+	int tm_drawn_sy;
+	bool tm_valid;								// false if the whole window must be drawn
+
+	uvga_raster_op raster_op;
+
+	// polygon edge tables
+	uint8_t *poly_buffer;
+	int poly_buffer_size;
+	bool poly_buffer_allocated;				// buffer allocated by the library
+
+	// image import
+	int16_t *import_err;						// 2 rows of errors (UVGA_DITHER_DIFFUSION only)
+	int import_x;
+	int import_y;								// frame buffer row of the next imported row
+	int import_w;
+	uvga_dither import_dither;
+
+	// dirty region
+	uint32_t *dirty_map;						// 1 bit per cell, NULL if tracking is disabled
+	int dirty_words_per_row;
+	short dirty_cols;
+	short dirty_rows;
+	uint8_t dirty_cell_w_shift;
+	uint8_t dirty_cell_h_shift;
+
+	// glyph cache
+	uvga_glyph_cache_entry_t *glyph_cache;	// NULL if there is no cache
+	uint8_t *glyph_cache_tiles;				// glyph_cache_tile_size bytes per entry
+	short *glyph_cache_buckets;				// first entry of each hash chain
+	int glyph_cache_bucket_mask;
+	int glyph_cache_tile_size;
+	short glyph_cache_tile_w;
+	short glyph_cache_tile_h;
+	short glyph_cache_nb_entries;
+	short glyph_cache_head;						// most recently used entry
+	short glyph_cache_tail;						// least recently used entry
+	uint32_t glyph_cache_hits;
+	uint32_t glyph_cache_misses;
+
 	void clocks_init();
 	void signal_pins_init();
 
 	uvga_error_t dma_init();
 	uvga_error_t rgb332_dma_init_dma_single_repeat_1();
 	uvga_error_t rgb332_dma_init_dma_single_repeat_more_than_1();
-	uvga_error_t rgb332_dma_init_dma_multiple_repeat_1();
-	uvga_error_t rgb332_dma_init_dma_multiple_repeat_2();
-	uvga_error_t rgb332_dma_init_dma_multiple_repeat_more_than_2();
-	uvga_error_t monochrome_dma_init_repeat_1();
+	uvga_error_t rgb332_dma_init_line_buffer();
+	uvga_error_t rgb332_dma_init_dma_staging();
+	void dma_init_black_pixel_channel();
 
 	DMABaseClass::TCD_t *dma_append_vsync_tcds(DMABaseClass::TCD_t *cur_tcd);
+
+	uvga_error_t line_buffer_init();
+	uvga_error_t line_buffer_build_groups();
+	void line_buffer_start();
+	void line_buffer_render_group(int group);
+	static void line_buffer_isr();
+
+	uvga_error_t line_offsets_init();
+	uvga_error_t canvas_init();
+	uvga_error_t bands_init();
+	void layout_compute_row_pointers();
+	void layout_patch_lines(int t, int last);
+	void layout_patch_row(int y);
+	void layout_patch_all();
+	int layout_line_band(int t);
+	void line_buffer_patch_tcds();
+	void staging_patch();
+	void staging_prefetch();
+
+	// true if display line t is displayed from a SRAM_L slot
+	inline bool staging_line_is_staged(int t)
+	{
+		return canvas_enabled || ((((int)fb_row_pointer[t]) + fb_row_stride - 1) >= SRAM_U_START_ADDRESS);
+	}
+
+	// number of display lines starting at t which can be displayed by a single TCD
+	inline int staging_direct_run(int t)
+	{
+		int n = 1;
+
+		if(staging_line_is_staged(t))
+			return 1;
+
+		while(((t + n) < img_h_no_margin) && (!staging_line_is_staged(t + n)) && (fb_row_pointer[t + n] == (fb_row_pointer[t + n - 1] + fb_row_stride)))
+			n++;
+
+		return n;
+	}
+
+	// frame buffer row displayed by display line t (without band)
+	inline int layout_line_row(int t)
+	{
+		int row;
+
+		row = vp_y + zoom_first_row + (t << 8) / (complex_mode_ydiv * zoom_scale);
+		if(row >= fb_height)
+			row = fb_height - 1;
+
+		return row;
+	}
+
+	// first displayed pixel of displayed row y in its frame buffer row
+	inline int layout_row_x(int y)
+	{
+		int x = vp_x;
+
+		if(line_offsets != NULL)
+			x += line_offsets[y];
+
+		if(x > (fb_width - img_w))
+			x = fb_width - img_w;
+
+		return x;
+	}
+
+	// first displayed pixel of display line t in its frame buffer row
+	inline int layout_line_x(int t)
+	{
+		if(nb_bands > 0)
+			return bands[layout_line_band(t)].scroll_x;
+
+		return layout_row_x(t / complex_mode_ydiv);
+	}
+
+	// true if display line t does not display the same frame buffer row as line t - 1
+	inline bool layout_new_row(int t)
+	{
+		int b;
+
+		if(t == 0)
+			return true;
+
+		if(nb_bands > 0)
+		{
+			b = layout_line_band(t);
+			return ((t - bands[b].first_line) % bands[b].repeat_line) == 0;
+		}
+
+		return layout_line_row(t) != layout_line_row(t - 1);
+	}
+
+	uvga_error_t palette_init();
+	void palette_build_lut();
+	void palette_expand_row(uint8_t *line_buffer, const uint8_t *row);
+	void color_lut_copy_row(uint8_t *line_buffer, const uint8_t *row, const uint8_t *lut);
 	
 	void stop();
 	void set_pin_alternate_function_to_FTM(int pin_num);
@@ -398,8 +977,50 @@ private:
 	inline void add_end_of_image_dma_trigger(DMABaseClass::TCD_t *cur_tcd);
 
 	inline void wait_idle_gfx_dma();
+	void wait_gfx_dma_end();
+	void store_pixel(int x, int y, int color);	// no clipping, no raster operation
 	void init_text_settings();
 
+	inline uvga_text_cell_t *text_cell(int column, int line);
+	inline void text_mark_dirty(int column, int line);
+	void text_set_cell(int column, int line, uint8_t c, uint8_t fg, int bg);
+	void text_scroll();
+	void scroll_print_window_lines(int nb_lines);
+	void scroll_print_window_region(int top, int bottom, int nb_lines);
+	void shift_print_window_chars(int line, int column, int nb_chars);
+	void erase_print_window_chars(int line, int first_column, int last_column);
+	void erase_print_window_lines(int first_line, int last_line);
+	void text_scroll_region(int top, int bottom, int nb_lines);
+	void text_shift_line(int line, int column, int nb_chars);
+
+	uvga_error_t sprite_set_image(int n, const uint8_t *bitmap, int width, int height, int key_color, bool rle);
+	void sprite_copy_area(uvga_sprite_t *s, bool save);
+
+	void tilemap_render_row(uint8_t *dst, int y, int x0, int x1);
+	void tilemap_render_area(int x0, int y0, int x1, int y1);
+	void tilemap_move(int dx, int dy);
+
+	// called by drawing functions with the clipped area they modify, nothing is done if tracking is disabled
+	inline void dirty_mark(int x0, int y0, int x1, int y1) { if(dirty_map != NULL) dirty_mark_area(x0, y0, x1, y1); }
+	void dirty_mark_area(int x0, int y0, int x1, int y1);
+
+	size_t terminal_write(uint8_t c);
+	size_t terminal_write(const uint8_t *buffer, size_t size);
+	void term_reset();
+	void term_apply_colors();
+	inline void term_check_region();
+	inline int term_param(int n, int def);
+	void term_line_feed();
+	void term_reverse_line_feed();
+	void term_put_chars(const uint8_t *text, int n);
+	void term_sgr();
+	void term_csi(uint8_t c);
+	void text_clear();
+
+	inline void glyph_cache_touch(int e);
+	inline void glyph_cache_unhash(int e);
+	const uint8_t *glyph_cache_lookup(const uint8_t *glyph, uint8_t fg, uint8_t bg);
+
 	int FTM_prescaler_to_selection(int prescaler);
 	uint8_t *alloc_32B_align(int size);
 
@@ -416,9 +1037,20 @@ private:
 	inline int _getPixel(int x, int y);
 	inline int getPixelFast(int x, int y);
 	inline void drawPixelFast(int x, int y, int color);
+	inline void putPixelFast(int x, int y, int color);
 	inline void drawHLineFast(int y, int x1, int x2, int color);
 	inline void drawVLineFast(int x, int y1, int y2, int color);
 
+	// raster operation kernels called by the functions above when the raster operation is not COPY
+	void rop_pixel(int x, int y, int color);
+	void rop_hline(int y, int x1, int x2, int color);
+	void rop_vline(int x, int y1, int y2, int color);
+
+	void import_row(const uint8_t *rgb888, const uint16_t *rgb565);
+
+	uvga_error_t image_decode(int x, int y, const uint8_t *image, int image_size, uvga_image_read_callback_t read, void *context, const uvga_rect_t *clip);
+	inline void image_span(uint8_t *fb_row, int y, int x, int n, const uint8_t *src, int color, int clip_x0, int clip_x1);
+
 	inline void drawLinex(int x0, int y0, int x1, int y1, int color)
 	{
 		drawLine(x0, y0, x1, y1, color, true);
@@ -427,11 +1059,22 @@ private:
 	inline void Vscroll(int x, int y, int w, int h, int dy ,int col);
 	inline void Hscroll(int x, int y, int w, int h, int dx ,int col);
 
+	// glyph blitters used by drawText. bg_col = -1 for transparent background
+	void drawGlyph(const uint8_t *glyph, int x, int y, int fg_col, int bg_col, uvga_text_direction dir);
+	void drawTextRun(const uint8_t *text, int n, int x, int y, int fg_col, int bg_col);
+	inline void drawGlyphRight(uint8_t *dst, const uint8_t *glyph, int fg_col, int bg_col);
+	inline void drawGlyphTile(uint8_t *dst, const uint8_t *tile);
+	inline void drawGlyphRotated(uint8_t *dst, int step_i, int step_j, const uint8_t *glyph, int fg_col, int bg_col);
+	void drawGlyphSpans(const uint8_t *glyph, int w, int pitch, int h, int x, int y, int fg_col, int bg_col, uvga_text_direction dir);
+	inline void glyph_fill_span(int x0, int y0, int x1, int y1, int color);
+	void drawGlyphClipped(const uint8_t *glyph, int x, int y, int x0, int y0, int x1, int y1, int fg_col, int bg_col, uvga_text_direction dir);
+
 	void dump_tcd(DMABaseClass::TCD_t *tcd);
 };
 
 extern uVGA uvga;
 extern unsigned char _vga_font8x8[];
+extern const uvga_font_t uvga_font8x8;
 
 // various macros to compute frame buffer size and line position inside it
 // image_width is the number of pixels per line
@@ -450,15 +1093,46 @@ extern unsigned char _vga_font8x8[];
 // height of the frame buffer
 #define UVGA_FB_HEIGHT(image_height, repeat_line_factor, top_margin, bottom_margin)		(((image_height) - (top_margin) - (bottom_margin) + (repeat_line_factor) - 1) / (repeat_line_factor))
 
+// size of the frame buffer in byte, including nb_staging_buffers SRAM_L buffers
+#define UVGA_STAGED_FB_SIZE(image_width, image_height, repeat_line_factor, top_margin, bottom_margin, nb_staging_buffers)    	((UVGA_FB_ROW_STRIDE(image_width) * (UVGA_FB_HEIGHT(image_height, repeat_line_factor, top_margin, bottom_margin) + (nb_staging_buffers)) + 15))
+
 // size of the frame buffer in byte, including SRAM_L buffer
+// if rows are located in SRAM_U, begin() allocates the ring of staging buffers apart. Use UVGA_STAGED_FB_SIZE() and set_staging_buffers() to include it
 #define UVGA_FB_SIZE(image_width, image_height, repeat_line_factor, top_margin, bottom_margin)    	((UVGA_FB_ROW_STRIDE(image_width) * (UVGA_FB_HEIGHT(image_height, repeat_line_factor, top_margin, bottom_margin) + 1) + 15))
 
+// size of the frame buffer in byte when UVGA_DMA_LINE_BUFFER is used, including the ring of nb_line_buffers SRAM_L buffers
+#define UVGA_LB_FB_SIZE(image_width, image_height, repeat_line_factor, top_margin, bottom_margin, nb_line_buffers)    	((UVGA_FB_ROW_STRIDE(image_width) * (UVGA_FB_HEIGHT(image_height, repeat_line_factor, top_margin, bottom_margin) + (nb_line_buffers)) + 15))
+
+// size of the line buffer ring in byte when UVGA_DMA_LINE_BUFFER is used with a scanline callback (no frame buffer)
+#define UVGA_LB_SIZE(image_width, nb_line_buffers)    	((UVGA_FB_ROW_STRIDE(image_width) * (nb_line_buffers) + 15))
+
+// size of line in packed frame buffer (in bytes) of UVGA_PAL1 (bpp = 1), UVGA_PAL2 (bpp = 2) and UVGA_PAL4 (bpp = 4)
+#define UVGA_PACKED_ROW_STRIDE(image_width, bpp)				(((((image_width) * (bpp) + 7) >> 3) + 15) & 0xFFF0)
+
+// size of the frame buffer in byte of UVGA_PAL1 (bpp = 1), UVGA_PAL2 (bpp = 2) and UVGA_PAL4 (bpp = 4), including the ring of nb_line_buffers SRAM_L buffers
+#define UVGA_PAL_FB_SIZE(image_width, image_height, repeat_line_factor, top_margin, bottom_margin, bpp, nb_line_buffers)    	((UVGA_FB_ROW_STRIDE(image_width) * (nb_line_buffers) + UVGA_PACKED_ROW_STRIDE(image_width, bpp) * UVGA_FB_HEIGHT(image_height, repeat_line_factor, top_margin, bottom_margin) + 15))
+
+// size of line in a virtual canvas (in bytes). Up to 15 bytes are reserved before the first pixel for SRAM_U DMA alignment
+#define UVGA_CANVAS_ROW_STRIDE(canvas_width)						(UVGA_FB_ROW_STRIDE((canvas_width) + 15))
+
+// size of a virtual canvas in byte, including nb_staging_buffers SRAM_L buffers
+#define UVGA_STAGED_CANVAS_SIZE(image_width, canvas_width, canvas_height, nb_staging_buffers)	(((((image_width) + 15) & 0xFFF0) + 16) * (nb_staging_buffers) + UVGA_CANVAS_ROW_STRIDE(canvas_width) * (canvas_height) + 15)
+
+// size of a virtual canvas in byte, including 2 SRAM_L buffers
+#define UVGA_CANVAS_SIZE(image_width, canvas_width, canvas_height)	UVGA_STAGED_CANVAS_SIZE(image_width, canvas_width, canvas_height, 2)
+
+// size of a split screen band buffer in byte
+#define UVGA_BAND_SIZE(band_width, band_height)						(UVGA_FB_ROW_STRIDE(band_width) * (band_height))
+
 // address of first byte used in preallocated buffer, it is also the address of SRAM_L buffer
 #define UVGA_BUFFER_START(allocated_frame_buffer)				((uint8_t *)(((int)(allocated_frame_buffer) + 15) & ~0xF))
 
 // address of first byte of the frame buffer inside preallocated buffer
 #define UVGA_FB_START(allocated_frame_buffer, fb_row_stride)	((allocated_frame_buffer) + (fb_row_stride))
 
+// address of first byte of the frame buffer inside preallocated buffer of UVGA_STAGED_FB_SIZE() bytes
+#define UVGA_STAGED_FB_START(allocated_frame_buffer, fb_row_stride, nb_staging_buffers)	((allocated_frame_buffer) + (fb_row_stride) * (nb_staging_buffers))
+
 // address of line in frame buffer (0 <= y < fb_height)
 #define UVGA_LINE_ADDRESS(allocated_frame_buffer, fb_row_stride, y)     (UVGA_FB_START(allocated_frame_buffer, fb_row_stride) + (y) * (fb_row_stride))
 
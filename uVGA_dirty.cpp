@@ -0,0 +1,253 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Dirty region tracking
+
+// The frame buffer is divided in cells of 2^n x 2^m pixels, a bitmap contains 1 bit per cell. Each drawing function marks the cells
+// covered by the area it modified after clipping (composite functions like lines, circles or text go through the basic ones).
+// When tracking is disabled, the bitmap pointer is NULL and marking costs a single test.
+
+// getDirtyRects() merges horizontal runs of dirty cells, then stacks runs having the same columns on consecutive rows.
+// The result is a short list of rectangles to transfer or to redraw (partial update of an external display, network streaming...).
+
+// ============================================================================
+// allocate the cell bitmap for the current frame buffer. Must be called after begin()
+uvga_error_t uVGA::enableDirtyTracking(int cell_w, int cell_h)
+{
+	int w_shift;
+	int h_shift;
+	int nb_words;
+
+	disableDirtyTracking();
+
+	if((fb_width <= 0) || (fb_height <= 0))
+		return UVGA_OK;
+
+	// cell size is rounded up to a power of 2, pixel to cell conversion is a shift
+	w_shift = 0;
+	while((1 << w_shift) < cell_w)
+		w_shift++;
+
+	h_shift = 0;
+	while((1 << h_shift) < cell_h)
+		h_shift++;
+
+	dirty_cols = (fb_width + (1 << w_shift) - 1) >> w_shift;
+	dirty_rows = (fb_height + (1 << h_shift) - 1) >> h_shift;
+	dirty_words_per_row = (dirty_cols + 31) >> 5;
+	dirty_cell_w_shift = w_shift;
+	dirty_cell_h_shift = h_shift;
+
+	nb_words = dirty_words_per_row * dirty_rows;
+	dirty_map = (uint32_t *) malloc(sizeof(uint32_t) * nb_words);
+	if(dirty_map == NULL)
+		return UVGA_FAIL_TO_ALLOCATE_DIRTY_MAP;
+
+	memset(dirty_map, 0, sizeof(uint32_t) * nb_words);
+
+	return UVGA_OK;
+}
+
+void uVGA::disableDirtyTracking()
+{
+	if(dirty_map != NULL)
+	{
+		free(dirty_map);
+		dirty_map = NULL;
+	}
+}
+
+void uVGA::clearDirty()
+{
+	if(dirty_map != NULL)
+		memset(dirty_map, 0, sizeof(uint32_t) * dirty_words_per_row * dirty_rows);
+}
+
+void uVGA::markDirty(int x0, int y0, int x1, int y1)
+{
+	dirty_mark(x0, y0, x1, y1);
+}
+
+// ============================================================================
+// set the bits of the cells covered by an area (coordinates in pixels, in any order)
+void uVGA::dirty_mark_area(int x0, int y0, int x1, int y1)
+{
+	int c0, c1;
+	int r;
+	int w0, w1;
+	int w;
+	uint32_t m0, m1;
+	uint32_t *row;
+
+	if(x0 > x1)
+	{
+		w = x0;
+		x0 = x1;
+		x1 = w;
+	}
+
+	if(y0 > y1)
+	{
+		w = y0;
+		y0 = y1;
+		y1 = w;
+	}
+
+	if((x1 < 0) || (y1 < 0))
+		return;
+
+	if(x0 < 0)
+		x0 = 0;
+	if(y0 < 0)
+		y0 = 0;
+
+	c0 = x0 >> dirty_cell_w_shift;
+	c1 = x1 >> dirty_cell_w_shift;
+	y0 >>= dirty_cell_h_shift;
+	y1 >>= dirty_cell_h_shift;
+
+	if((c0 >= dirty_cols) || (y0 >= dirty_rows))
+		return;
+
+	if(c1 >= dirty_cols)
+		c1 = dirty_cols - 1;
+	if(y1 >= dirty_rows)
+		y1 = dirty_rows - 1;
+
+	w0 = c0 >> 5;
+	w1 = c1 >> 5;
+	m0 = 0xFFFFFFFF << (c0 & 31);					// bits c0..31 of the first word
+	m1 = 0xFFFFFFFF >> (31 - (c1 & 31));			// bits 0..c1 of the last word
+
+	row = dirty_map + y0 * dirty_words_per_row;
+
+	for(r = y0; r <= y1; r++, row += dirty_words_per_row)
+	{
+		if(w0 == w1)
+			row[w0] |= m0 & m1;
+		else
+		{
+			row[w0] |= m0;
+			for(w = w0 + 1; w < w1; w++)
+				row[w] = 0xFFFFFFFF;
+			row[w1] |= m1;
+		}
+	}
+}
+
+// ============================================================================
+// merge dirty cells into rectangles (in pixels, clipped to the frame buffer)
+// if more than max_rects rectangles are required, the last one is the union of all remaining areas
+int uVGA::getDirtyRects(uvga_rect_t *rects, int max_rects, bool clear)
+{
+	int nb_rects;
+	int first_open;		// rectangles before this one cannot be extended anymore
+	int r, c, c0;
+	int i;
+	uint32_t *row;
+	uvga_rect_t *rect;
+
+	if((dirty_map == NULL) || (rects == NULL) || (max_rects <= 0))
+		return 0;
+
+	nb_rects = 0;
+	first_open = 0;
+
+	// rectangles are built in cell units
+	for(r = 0, row = dirty_map; r < dirty_rows; r++, row += dirty_words_per_row)
+	{
+		i = nb_rects;
+
+		c = 0;
+		while(c < dirty_cols)
+		{
+			// skip empty words
+			if(((c & 31) == 0) && (row[c >> 5] == 0))
+			{
+				c += 32;
+				continue;
+			}
+
+			if(!(row[c >> 5] & (1UL << (c & 31))))
+			{
+				c++;
+				continue;
+			}
+
+			// run of dirty cells c0..c-1
+			c0 = c;
+			while((c < dirty_cols) && (row[c >> 5] & (1UL << (c & 31))))
+				c++;
+
+			// a rectangle ending on the previous row with the same columns grows down, otherwise a new one starts
+			for(rect = rects + first_open; rect < rects + nb_rects; rect++)
+			{
+				if((rect->y1 == (r - 1)) && (rect->x0 == c0) && (rect->x1 == (c - 1)))
+					break;
+			}
+
+			if(rect < rects + nb_rects)
+				rect->y1 = r;
+			else if(nb_rects < max_rects)
+			{
+				rect->x0 = c0;
+				rect->y0 = r;
+				rect->x1 = c - 1;
+				rect->y1 = r;
+				nb_rects++;
+			}
+			else
+			{
+				rect = rects + max_rects - 1;
+				if(c0 < rect->x0)
+					rect->x0 = c0;
+				if((c - 1) > rect->x1)
+					rect->x1 = c - 1;
+				rect->y1 = r;
+			}
+		}
+
+		// rectangles not extended on this row are closed
+		while((first_open < i) && (rects[first_open].y1 != r))
+			first_open++;
+	}
+
+	// cell units to pixels
+	for(rect = rects; rect < rects + nb_rects; rect++)
+	{
+		rect->x0 <<= dirty_cell_w_shift;
+		rect->y0 <<= dirty_cell_h_shift;
+		rect->x1 = ((rect->x1 + 1) << dirty_cell_w_shift) - 1;
+		rect->y1 = ((rect->y1 + 1) << dirty_cell_h_shift) - 1;
+
+		if(rect->x1 >= fb_width)
+			rect->x1 = fb_width - 1;
+		if(rect->y1 >= fb_height)
+			rect->y1 = fb_height - 1;
+	}
+
+	if(clear)
+		clearDirty();
+
+	return nb_rects;
+}
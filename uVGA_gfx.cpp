@@ -20,6 +20,7 @@
 */
 
 #include "uVGA.h"
+#include <math.h>
 
 #define dump(v)      {Serial.print(#v ":"); Serial.println(v);}
 
@@ -54,10 +55,27 @@ inline void uVGA::wait_idle_gfx_dma()
 #endif
 }
 
+// same as wait_idle_gfx_dma() for functions defined in other files
+void uVGA::wait_gfx_dma_end()
+{
+	wait_idle_gfx_dma();
+}
+
+// same as putPixelFast() for functions defined in other files
+void uVGA::store_pixel(int x, int y, int color)
+{
+	putPixelFast(x, y, color);
+}
+
 // clear screen with an optional color
 void uVGA::clear(int color)
 {
+	uvga_raster_op op = raster_op;
+
+	// clear is never blended
+	raster_op = UVGA_ROP_COPY;
 	uVGA::fillRect(0, 0, fb_width - 1, fb_height - 1, color);
+	raster_op = op;
 }
 
 // draw a single pixel. If the pixel is out of screen, it is not displayed
@@ -71,13 +89,40 @@ void uVGA::drawPixel(int x, int y, int color)
 
 	wait_idle_gfx_dma();
 
+	dirty_mark(x, y, x, y);
 	drawPixelFast(x, y, color);
 }
 
 // draw a single pixel WITHOUT performing any clipping test
 inline void uVGA::drawPixelFast(int x, int y, int color)
 {
-	frame_buffer[y * fb_row_stride + x] = color;
+	if(raster_op != UVGA_ROP_COPY)
+	{
+		rop_pixel(x, y, color);
+		return;
+	}
+
+	putPixelFast(x, y, color);
+}
+
+// store a single pixel WITHOUT clipping test and raster operation (bitmaps, copy)
+inline void uVGA::putPixelFast(int x, int y, int color)
+{
+	uint8_t *ptr;
+	int shift;
+
+	if(fb_bpp == 8)
+	{
+		frame_buffer[y * fb_row_stride + x] = color;
+		return;
+	}
+
+	// packed pixels, first pixel in MSB
+	x <<= fb_bpp_shift;		// x is now a bit position
+	ptr = frame_buffer + y * fb_row_stride + (x >> 3);
+	shift = 8 - fb_bpp - (x & 7);
+
+	*ptr = (*ptr & ~(fb_pixel_mask << shift)) | ((color & fb_pixel_mask) << shift);
 }
 
 int uVGA::getPixel(int x, int y)
@@ -100,7 +145,12 @@ inline int uVGA::_getPixel(int x, int y)
 
 inline int uVGA::getPixelFast(int x, int y)
 {
-	return *(frame_buffer + y * fb_row_stride + x);
+	if(fb_bpp == 8)
+		return *(frame_buffer + y * fb_row_stride + x);
+
+	// packed pixels, first pixel in MSB
+	x <<= fb_bpp_shift;		// x is now a bit position
+	return (*(frame_buffer + y * fb_row_stride + (x >> 3)) >> (8 - fb_bpp - (x & 7))) & fb_pixel_mask;
 }
 
 // draw a horizontal line pixel with clipping
@@ -118,6 +168,8 @@ void uVGA::drawHLine(int y, int x1, int x2, int color)
 
 	wait_idle_gfx_dma();
 
+	dirty_mark(nx1, y, nx2, y);
+
 	if(x1 <= x2)
 		drawHLineFast(y, nx1, nx2, color);
 	else
@@ -128,6 +180,41 @@ void uVGA::drawHLine(int y, int x1, int x2, int color)
 // x1 always <= x2
 inline void uVGA::drawHLineFast(int y, int x1, int x2, int color)
 {
+	if(raster_op != UVGA_ROP_COPY)
+	{
+		rop_hline(y, x1, x2, color);
+		return;
+	}
+
+	if(fb_bpp != 8)
+	{
+		int pix_per_byte = 8 >> fb_bpp_shift;
+		int nb;
+		uint8_t pattern;
+
+		// pixels before the first full byte
+		while((x1 <= x2) && (x1 & (pix_per_byte - 1)))
+			drawPixelFast(x1++, y, color);
+
+		// full bytes
+		nb = (x2 - x1 + 1) >> (3 - fb_bpp_shift);
+		if(nb > 0)
+		{
+			pattern = color & fb_pixel_mask;
+			for(int b = fb_bpp; b < 8; b <<= 1)
+				pattern |= pattern << b;
+
+			memset(frame_buffer + y * fb_row_stride + ((x1 << fb_bpp_shift) >> 3), pattern, nb);
+			x1 += nb * pix_per_byte;
+		}
+
+		// pixels after the last full byte
+		while(x1 <= x2)
+			drawPixelFast(x1++, y, color);
+
+		return;
+	}
+
 #ifdef NO_DMA_GFX
 	uint8_t *ptr = frame_buffer + y * fb_row_stride + x1;
 #ifdef FAST_HLINE
@@ -200,6 +287,8 @@ void uVGA::drawVLine(int x, int y1, int y2, int color)
 
 	wait_idle_gfx_dma();
 
+	dirty_mark(x, ny1, x, ny2);
+
 	if(y1 <= y2)
 		drawVLineFast(x, ny1, ny2, color);
 	else
@@ -210,6 +299,35 @@ void uVGA::drawVLine(int x, int y1, int y2, int color)
 // y1 always <= y2
 inline void uVGA::drawVLineFast(int x, int y1, int y2, int color)
 {
+	if(raster_op != UVGA_ROP_COPY)
+	{
+		rop_vline(x, y1, y2, color);
+		return;
+	}
+
+	if(fb_bpp != 8)
+	{
+		uint8_t *ptr;
+		int shift;
+		uint8_t mask;
+		uint8_t value;
+
+		// packed pixels, all pixels are at the same position in their byte
+		ptr = frame_buffer + y1 * fb_row_stride + ((x << fb_bpp_shift) >> 3);
+		shift = 8 - fb_bpp - ((x << fb_bpp_shift) & 7);
+		mask = ~(fb_pixel_mask << shift);
+		value = (color & fb_pixel_mask) << shift;
+
+		while(y1 <= y2)
+		{
+			*ptr = (*ptr & mask) | value;
+			ptr += fb_row_stride;
+			y1++;
+		}
+
+		return;
+	}
+
 #ifdef NO_DMA_GFX
 	uint8_t *ptr = frame_buffer + y1 * fb_row_stride + x;
 
@@ -237,6 +355,198 @@ inline void uVGA::drawVLineFast(int x, int y1, int y2, int color)
 #endif
 }
 
+// ============================================================================
+// raster operations
+// ============================================================================
+void uVGA::setRasterOp(uvga_raster_op op)
+{
+	raster_op = op;
+}
+
+uvga_raster_op uVGA::getRasterOp()
+{
+	return raster_op;
+}
+
+// RGB332 components are averaged on 4 pixels at once: (a + b) / 2 = (a & b) + ((a ^ b) >> 1) on each component.
+// The lowest bit of each component (0x25 in each byte) is removed before the shift, no bit moves into the next component or pixel
+#define ROP_HALF_MASK		0xDADADADA
+
+static inline uint32_t rop_blend50(uint32_t d, uint32_t c)
+{
+	return (d & c) + (((d ^ c) & ROP_HALF_MASK) >> 1);
+}
+
+static inline uint32_t rop_blend25(uint32_t d, uint32_t c)
+{
+	return rop_blend50(d, rop_blend50(d, c));
+}
+
+// d and c contain 1 to 4 pixels (or a packed byte), result bytes only depend on the same bytes of d and c
+static inline uint32_t rop_apply(uvga_raster_op op, uint32_t d, uint32_t c)
+{
+	switch(op)
+	{
+		case UVGA_ROP_XOR:
+										return d ^ c;
+		case UVGA_ROP_AND:
+										return d & c;
+		case UVGA_ROP_OR:
+										return d | c;
+		case UVGA_ROP_BLEND50:
+										return rop_blend50(d, c);
+		case UVGA_ROP_BLEND25:
+										return rop_blend25(d, c);
+		default:
+										return c;
+	}
+}
+
+// blends have no meaning on palette indexes
+#define ROP_PACKED_OP(op)	(((op) == UVGA_ROP_BLEND50) || ((op) == UVGA_ROP_BLEND25) ? UVGA_ROP_COPY : (op))
+
+// span kernel: bytes until ptr is 32 bits aligned, 4 pixels per access, remaining bytes. d is the previous content, c4 the color in each byte
+#define ROP_SPAN(expr)																		\
+	{																							\
+		while((((uint32_t)ptr) & 3) && (nb > 0))									\
+		{																						\
+			d = *ptr;																		\
+			*ptr++ = (expr);																\
+			nb--;																				\
+		}																						\
+		while(nb >= 4)																		\
+		{																						\
+			d = *((uint32_t *)ptr);														\
+			*((uint32_t *)ptr) = (expr);												\
+			ptr += 4;																		\
+			nb -= 4;																			\
+		}																						\
+		while(nb > 0)																		\
+		{																						\
+			d = *ptr;																		\
+			*ptr++ = (expr);																\
+			nb--;																				\
+		}																						\
+	}
+
+// single pixel WITHOUT clipping
+void uVGA::rop_pixel(int x, int y, int color)
+{
+	uint8_t *ptr;
+	int shift;
+	uint8_t mask;
+
+	if(fb_bpp == 8)
+	{
+		ptr = frame_buffer + y * fb_row_stride + x;
+		*ptr = rop_apply(raster_op, *ptr, color & 0xFF);
+		return;
+	}
+
+	x <<= fb_bpp_shift;
+	ptr = frame_buffer + y * fb_row_stride + (x >> 3);
+	shift = 8 - fb_bpp - (x & 7);
+	mask = fb_pixel_mask << shift;
+
+	*ptr = (*ptr & ~mask) | (rop_apply(ROP_PACKED_OP(raster_op), *ptr, (color & fb_pixel_mask) << shift) & mask);
+}
+
+// horizontal line WITHOUT clipping, x1 <= x2. Each operation has its own loop, the operation is not tested for each pixel
+void uVGA::rop_hline(int y, int x1, int x2, int color)
+{
+	uint8_t *ptr;
+	int nb;
+	uint32_t d;
+	uint32_t c4;
+
+	if(fb_bpp != 8)
+	{
+		uvga_raster_op op = ROP_PACKED_OP(raster_op);
+		int pix_per_byte = 8 >> fb_bpp_shift;
+		uint8_t pattern;
+
+		while((x1 <= x2) && (x1 & (pix_per_byte - 1)))
+			rop_pixel(x1++, y, color);
+
+		nb = (x2 - x1 + 1) >> (3 - fb_bpp_shift);
+		if(nb > 0)
+		{
+			pattern = color & fb_pixel_mask;
+			for(int b = fb_bpp; b < 8; b <<= 1)
+				pattern |= pattern << b;
+
+			ptr = frame_buffer + y * fb_row_stride + ((x1 << fb_bpp_shift) >> 3);
+			x1 += nb * pix_per_byte;
+
+			while(nb--)
+			{
+				*ptr = rop_apply(op, *ptr, pattern);
+				ptr++;
+			}
+		}
+
+		while(x1 <= x2)
+			rop_pixel(x1++, y, color);
+
+		return;
+	}
+
+	ptr = frame_buffer + y * fb_row_stride + x1;
+	nb = x2 - x1 + 1;
+	c4 = (color & 0xFF) * 0x01010101;
+
+	switch(raster_op)
+	{
+		case UVGA_ROP_XOR:
+										ROP_SPAN(d ^ c4);
+										break;
+		case UVGA_ROP_AND:
+										ROP_SPAN(d & c4);
+										break;
+		case UVGA_ROP_OR:
+										ROP_SPAN(d | c4);
+										break;
+		case UVGA_ROP_BLEND50:
+										ROP_SPAN(rop_blend50(d, c4));
+										break;
+		case UVGA_ROP_BLEND25:
+										ROP_SPAN(rop_blend25(d, c4));
+										break;
+		default:
+										ROP_SPAN(c4);
+										break;
+	}
+}
+
+// vertical line WITHOUT clipping, y1 <= y2
+void uVGA::rop_vline(int x, int y1, int y2, int color)
+{
+	uint8_t *ptr;
+	int shift;
+	uint8_t mask;
+	uint32_t c;
+	uvga_raster_op op;
+
+	if(fb_bpp == 8)
+	{
+		ptr = frame_buffer + y1 * fb_row_stride + x;
+		c = color & 0xFF;
+		op = raster_op;
+		mask = 0xFF;
+	}
+	else
+	{
+		ptr = frame_buffer + y1 * fb_row_stride + ((x << fb_bpp_shift) >> 3);
+		shift = 8 - fb_bpp - ((x << fb_bpp_shift) & 7);
+		c = (color & fb_pixel_mask) << shift;
+		op = ROP_PACKED_OP(raster_op);
+		mask = fb_pixel_mask << shift;
+	}
+
+	for(; y1 <= y2; y1++, ptr += fb_row_stride)
+		*ptr = (*ptr & ~mask) | (rop_apply(op, *ptr, c) & mask);
+}
+
 void uVGA::fillRect(int x0, int y0, int x1, int y1, int color)
 {
 /*
@@ -251,6 +561,8 @@ void uVGA::fillRect(int x0, int y0, int x1, int y1, int color)
 	x1 = clip_x(x1);
 	y1 = clip_y(y1);
 
+	dirty_mark(x0, y0, x1, y1);
+
 	// increase speed if the rectangle is a single pixel, horizontal or vertical line
 	if( (x0 == x1) )
 	{
@@ -335,6 +647,7 @@ mettre DMA_DCHPRIx[ECP] = 1
 }
 
 // bitmap format must be the same as modeline.img_color_mode
+// in palette modes, bitmap contains 1 palette index per byte
 void uVGA::drawBitmap(int16_t x_pos, int16_t y_pos, uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height)
 {
 	int fx;
@@ -345,171 +658,577 @@ void uVGA::drawBitmap(int16_t x_pos, int16_t y_pos, uint8_t *bitmap, int16_t bit
 	int by;
 	int off_x, off_y;
 	uint8_t *bitmap_ptr;
+	uint8_t *fb_ptr;
+
+	// clip bitmap rectangle once
+	// (fx,fy) is the destination position in the image
+	// (bx,by) is the position in the bitmap
+	// (fw,fh) is the size to copy
+	fx = x_pos;
+	bx = 0;
+	fw = bitmap_width;
+	if(fx < 0)
+	{
+		bx = -fx;
+		fw += fx;
+		fx = 0;
+	}
+	if((fx + fw) > fb_width)
+		fw = fb_width - fx;
+
+	fy = y_pos;
+	by = 0;
+	fh = bitmap_height;
+	if(fy < 0)
+	{
+		by = -fy;
+		fh += fy;
+		fy = 0;
+	}
+	if((fy + fh) > fb_height)
+		fh = fb_height - fy;
 
-	fx = clip_x(x_pos);
-	// X position outside of image (right of image)
-	if(fx < x_pos)
+	// bitmap outside of image ?
+	if((fw <= 0) || (fh <= 0))
 		return;
 
-	// compute the number of pixels to skip at the beginning of each bitmap line and the number of pixel per line to copy
-	if(fx > x_pos)
-	{
-		bx = fx - x_pos;
-		fw = bitmap_width - bx;
+	wait_idle_gfx_dma();
 
-		// X position outside of image (right of image)
-		if(fw <= 0)
-			return;
-	}
-	else
-	{
-		bx = 0;
+	dirty_mark(fx, fy, fx + fw - 1, fy + fh - 1);
 
-		if( (fx + bitmap_width) >= fb_width)
-		{
-			fw = fb_width - fx;
-		}
-		else
+	bitmap_ptr = bitmap + by * bitmap_width + bx;
+
+	// packed pixels: 1 palette index per byte in bitmap
+	if(fb_bpp != 8)
+	{
+		for(off_y = 0; off_y < fh; off_y++, bitmap_ptr += bitmap_width)
 		{
-			fw = bitmap_width;
+			for(off_x = 0; off_x < fw; off_x++)
+				putPixelFast(fx + off_x, fy + off_y, bitmap_ptr[off_x]);
 		}
+		return;
 	}
 
-	fy = clip_y(y_pos);
-	// Y position outside of image (bottom of image)
-	if(fy < y_pos)
-		return;
+	fb_ptr = frame_buffer + fy * fb_row_stride + fx;
 
-	// compute the number of lines to skip at the beginning of bitmap and the number of lines to copy
-	if(fy > y_pos)
+	// 1 row copy per bitmap row (memcpy uses 32 bits accesses when source and destination are aligned)
+	for(off_y = 0; off_y < fh; off_y++)
 	{
-		by = fy - y_pos;
-		fh = bitmap_height - by;
+		memcpy(fb_ptr, bitmap_ptr, fw);
+		fb_ptr += fb_row_stride;
+		bitmap_ptr += bitmap_width;
+	}
+}
 
-		// Y position outside of image (right of image)
-		if(fh <= 0)
-			return;
+// draw a bitmap, pixels having key_color are not drawn. Bitmap format is the same as drawBitmap()
+void uVGA::drawBitmapKey(int16_t x_pos, int16_t y_pos, const uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height, uint8_t key_color)
+{
+	int fx, fy;
+	int fw, fh;
+	int bx, by;
+	int off_x, off_y;
+	int run;
+	const uint8_t *bitmap_ptr;
+	uint8_t *fb_ptr;
+
+	// clip bitmap rectangle once
+	fx = x_pos;
+	bx = 0;
+	fw = bitmap_width;
+	if(fx < 0)
+	{
+		bx = -fx;
+		fw += fx;
+		fx = 0;
 	}
-	else
+	if((fx + fw) > fb_width)
+		fw = fb_width - fx;
+
+	fy = y_pos;
+	by = 0;
+	fh = bitmap_height;
+	if(fy < 0)
 	{
-		by = 0;
+		by = -fy;
+		fh += fy;
+		fy = 0;
+	}
+	if((fy + fh) > fb_height)
+		fh = fb_height - fy;
+
+	if((fw <= 0) || (fh <= 0))
+		return;
+
+	wait_idle_gfx_dma();
+
+	dirty_mark(fx, fy, fx + fw - 1, fy + fh - 1);
 
-		if( (fy + bitmap_height) >= fb_height)
+	bitmap_ptr = bitmap + by * bitmap_width + bx;
+
+	for(off_y = 0; off_y < fh; off_y++, bitmap_ptr += bitmap_width)
+	{
+		if(fb_bpp != 8)
 		{
-			fh = fb_height - fy;
+			for(off_x = 0; off_x < fw; off_x++)
+			{
+				if(bitmap_ptr[off_x] != key_color)
+					putPixelFast(fx + off_x, fy + off_y, bitmap_ptr[off_x]);
+			}
+			continue;
 		}
-		else
+
+		fb_ptr = frame_buffer + (fy + off_y) * fb_row_stride + fx;
+
+		// copy each run of opaque pixels at once
+		off_x = 0;
+		while(off_x < fw)
 		{
-			fh = bitmap_height;
+			while((off_x < fw) && (bitmap_ptr[off_x] == key_color))
+				off_x++;
+
+			for(run = 0; ((off_x + run) < fw) && (bitmap_ptr[off_x + run] != key_color); run++);
+
+			if(run)
+			{
+				memcpy(fb_ptr + off_x, bitmap_ptr + off_x, run);
+				off_x += run;
+			}
 		}
 	}
+}
+
+// nearest pixel scaling. The bitmap position of each frame buffer pixel moves by a 16.16 fixed point step, divisions are only done once
+void uVGA::drawBitmapScaled(int16_t x_pos, int16_t y_pos, const uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height, int16_t width, int16_t height, int key_color)
+{
+	int fx0, fy0, fx1, fy1;	// visible rectangle
+	int x, y;
+	int32_t step_u, step_v;
+	int32_t u, u0, v;
+	const uint8_t *src;
+	uint8_t *dst;
+	uint8_t c;
+
+	if((width <= 0) || (height <= 0) || (bitmap_width <= 0) || (bitmap_height <= 0))
+		return;
+
+	fx0 = (x_pos < 0) ? 0 : x_pos;
+	fy0 = (y_pos < 0) ? 0 : y_pos;
+	fx1 = ((x_pos + width) > fb_width) ? fb_width - 1 : x_pos + width - 1;
+	fy1 = ((y_pos + height) > fb_height) ? fb_height - 1 : y_pos + height - 1;
+
+	if((fx0 > fx1) || (fy0 > fy1))
+		return;
+
+	// sample at the center of each frame buffer pixel
+	step_u = (bitmap_width << 16) / width;
+	step_v = (bitmap_height << 16) / height;
+	u0 = (step_u >> 1) + (fx0 - x_pos) * step_u;
+	v = (step_v >> 1) + (fy0 - y_pos) * step_v;
 
-	// here, (fx,fy) is the destination position in the image
-	//       (bx,by) is the position in the bitmap
-	//			(fw,fh) is the size to copy
-	
 	wait_idle_gfx_dma();
 
-	for(off_y = 0; off_y < fh; off_y++)
+	dirty_mark(fx0, fy0, fx1, fy1);
+
+	for(y = fy0; y <= fy1; y++, v += step_v)
 	{
-		bitmap_ptr = bitmap + (by + off_y) * bitmap_width + bx;
+		src = bitmap + (v >> 16) * bitmap_width;
+		u = u0;
 
-		for(off_x = 0; off_x < fw; off_x++)
+		if(fb_bpp != 8)
 		{
-			drawPixelFast(	fx + off_x,
-								fy + off_y,
-								*bitmap_ptr++
-					);
+			for(x = fx0; x <= fx1; x++, u += step_u)
+			{
+				c = src[u >> 16];
+				if(c != key_color)
+					putPixelFast(x, y, c);
+			}
+			continue;
 		}
-	}
 
+		dst = frame_buffer + y * fb_row_stride + fx0;
+
+		if(key_color == -1)
+		{
+			for(x = fx0; x <= fx1; x++, u += step_u)
+				*dst++ = src[u >> 16];
+		}
+		else
+		{
+			for(x = fx0; x <= fx1; x++, u += step_u, dst++)
+			{
+				c = src[u >> 16];
+				if(c != key_color)
+					*dst = c;
+			}
+		}
+	}
 }
 
+// smallest determinant of a drawBitmapAffine matrix (16.16 x 16.16): below, 1 bitmap pixel covers more than 65536 frame buffer pixels
+#define AFFINE_MIN_DET			65536.0f
 
+// v limited to [0, hi]
+static inline float affine_clamp(float v, float hi)
+{
+	return (v < 0) ? 0 : ((v > hi) ? hi : v);
+}
 
-#define SWAP(x,y) { (x)=(x)^(y); (y)=(x)^(y); (x)=(x)^(y); }
+// smallest integer >= a / b, b > 0
+static inline int64_t affine_ceil_div(int64_t a, int64_t b)
+{
+	return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+}
 
-// Fill a triangle - Bresenham method
-// Original from http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html
-void uVGA::fillTri(int x1, int y1, int x2, int y2, int x3, int y3, int color)
+// restrict [*k0,*k1] to the steps k where 0 <= p + k * dp < limit
+static inline void affine_clip_span(int64_t p, int32_t dp, int32_t limit, int *k0, int *k1)
 {
-	int t1x, t2x, y, minx, maxx, t1xp, t2xp;
-	bool changed1 = false;
-	bool changed2 = false;
-	int signx1, signx2, dx1, dy1, dx2, dy2;
-	int e1, e2;
+	int64_t a, b;
 
-	// Sort vertices
-	if (y1 > y2)
+	if(dp == 0)
 	{
-		SWAP(y1, y2);
-		SWAP(x1, x2);
+		if((p < 0) || (p >= limit))
+			*k1 = *k0 - 1;
+		return;
 	}
 
-	if (y1 > y3)
+	if(dp > 0)
 	{
-		SWAP(y1, y3);
-		SWAP(x1, x3);
+		a = affine_ceil_div(-p, dp);						// first k with p + k * dp >= 0
+		b = affine_ceil_div(limit - p, dp) - 1;		// last k with p + k * dp < limit
 	}
-
-	if (y2 > y3)
+	else
 	{
-		SWAP(y2, y3);
-		SWAP(x2, x3);
+		a = affine_ceil_div(p - limit + 1, -dp);		// first k with p + k * dp <= limit - 1
+		b = affine_ceil_div(p + 1, -dp) - 1;			// last k with p + k * dp >= 0
 	}
 
-	t1x = t2x = x1;
-	y = y1; // Starting points
+	if(a > *k0)
+		*k0 = (a > *k1) ? *k1 + 1 : a;
+	if(b < *k1)
+		*k1 = (b < *k0) ? *k0 - 1 : b;
+}
 
-	dx1 = x2 - x1;
+// affine transformation (rotation, scaling, shearing). The bounding box of the transformed bitmap is clipped to the frame buffer,
+// then on each row the span of pixels inside the bitmap is computed once: the inner loop only adds the 16.16 steps and never tests bitmap limits
+void uVGA::drawBitmapAffine(const uint8_t *bitmap, int16_t bitmap_width, int16_t bitmap_height, const int32_t *matrix, int key_color)
+{
+	float det;
+	float fu, fv;
+	float fx, fy;
+	float min_x, min_y, max_x, max_y;
+	int fx0, fy0, fx1, fy1;	// frame buffer area
+	int corner;
+	int x, y;
+	int k0, k1;
+	int32_t lim_u, lim_v;
+	int32_t du, dv;
+	int32_t u, v;
+	int64_t pu, pv;
+	uint8_t *dst;
+	uint8_t c;
+
+	if((bitmap_width <= 0) || (bitmap_height <= 0))
+		return;
 
-	//delta_and_sign(x0, x1, &delta_x, &sign_x);
-	if(dx1 < 0)
-	{
-		dx1 = -dx1;
-		signx1 = -1;
-	}
-	else
-	{
-		signx1 = 1;
-	}
+	// frame buffer position of the bitmap corners with the inverse matrix
+	det = ((float)matrix[0] * (float)matrix[4] - (float)matrix[1] * (float)matrix[3]);
+	if(fabsf(det) < AFFINE_MIN_DET)
+		return;
 
-	dy1 = y2 - y1;
-	dx2 = x3 - x1;
+	min_x = min_y = 1e9;
+	max_x = max_y = -1e9;
 
-	if(dx2 < 0)
-	{
-		dx2 = -dx2;
-		signx2 = -1;
-	}
-	else
+	for(corner = 0; corner < 4; corner++)
 	{
-		signx2 = 1;
+		fu = ((corner & 1) ? (float)bitmap_width * 65536.0f : 0) - (float)matrix[2];
+		fv = ((corner & 2) ? (float)bitmap_height * 65536.0f : 0) - (float)matrix[5];
+
+		fx = ((float)matrix[4] * fu - (float)matrix[1] * fv) / det;
+		fy = ((float)matrix[0] * fv - (float)matrix[3] * fu) / det;
+
+		if(fx < min_x)
+			min_x = fx;
+		if(fx > max_x)
+			max_x = fx;
+		if(fy < min_y)
+			min_y = fy;
+		if(fy > max_y)
+			max_y = fy;
 	}
 
-	dy2 = y3 - y1;
+	// transformed bitmap outside of the frame buffer ?
+	if((max_x < 0) || (max_y < 0) || (min_x >= fb_width) || (min_y >= fb_height))
+		return;
 
-	if (dy1 > dx1)     // swap values
-	{
-		SWAP(dx1, dy1);
-		changed1 = true;
-	}
+	// clamp before converting to int, the bounding box of a large magnification can be outside the int range
+	min_x = affine_clamp(min_x, fb_width);
+	max_x = affine_clamp(max_x, fb_width);
+	min_y = affine_clamp(min_y, fb_height);
+	max_y = affine_clamp(max_y, fb_height);
 
-	if (dy2 > dx2)     // swap values
-	{
-		SWAP(dy2, dx2);
-		changed2 = true;
-	}
+	// 1 pixel margin for rounding, each row span is computed exactly
+	fx0 = (min_x < 1) ? 0 : (int)min_x - 1;
+	fy0 = (min_y < 1) ? 0 : (int)min_y - 1;
+	fx1 = (max_x >= (fb_width - 1)) ? fb_width - 1 : (int)max_x + 1;
+	fy1 = (max_y >= (fb_height - 1)) ? fb_height - 1 : (int)max_y + 1;
 
-	e2 = dx2 >> 1;
+	if((fx0 > fx1) || (fy0 > fy1))
+		return;
 
-	// Flat top, just process the second half
-	if(y1 == y2)
-		goto next;
+	lim_u = bitmap_width << 16;
+	lim_v = bitmap_height << 16;
+	du = matrix[0];
+	dv = matrix[3];
 
-	e1 = dx1 >> 1;
+	wait_idle_gfx_dma();
 
-	for (int i = 0; i < dx1;)
+	dirty_mark(fx0, fy0, fx1, fy1);
+
+	for(y = fy0; y <= fy1; y++)
+	{
+		// bitmap position of the first pixel of the row and span of pixels inside the bitmap
+		pu = (int64_t)matrix[0] * fx0 + (int64_t)matrix[1] * y + matrix[2];
+		pv = (int64_t)matrix[3] * fx0 + (int64_t)matrix[4] * y + matrix[5];
+
+		k0 = 0;
+		k1 = fx1 - fx0;
+		affine_clip_span(pu, du, lim_u, &k0, &k1);
+		affine_clip_span(pv, dv, lim_v, &k0, &k1);
+
+		if(k0 > k1)
+			continue;
+
+		u = pu + (int64_t)k0 * du;
+		v = pv + (int64_t)k0 * dv;
+
+		if(fb_bpp != 8)
+		{
+			for(x = fx0 + k0; x <= fx0 + k1; x++, u += du, v += dv)
+			{
+				c = bitmap[(v >> 16) * bitmap_width + (u >> 16)];
+				if(c != key_color)
+					putPixelFast(x, y, c);
+			}
+			continue;
+		}
+
+		dst = frame_buffer + y * fb_row_stride + fx0 + k0;
+
+		for(x = k0; x <= k1; x++, u += du, v += dv, dst++)
+		{
+			c = bitmap[(v >> 16) * bitmap_width + (u >> 16)];
+			if(c != key_color)
+				*dst = c;
+		}
+	}
+}
+
+// inverse of: scale, rotate around (src_x,src_y) then move to (dst_x,dst_y). Pixels are sampled at their center
+void uVGA::makeAffineMatrix(int32_t *matrix, float angle, float scale, float src_x, float src_y, float dst_x, float dst_y)
+{
+	float c = cosf(angle) / scale;
+	float s = sinf(angle) / scale;
+	float ox = 0.5f - dst_x;		// frame buffer pixel center relative to dst point
+	float oy = 0.5f - dst_y;
+
+	matrix[0] = c * 65536.0f;
+	matrix[1] = s * 65536.0f;
+	matrix[2] = (c * ox + s * oy + src_x) * 65536.0f;
+	matrix[3] = -s * 65536.0f;
+	matrix[4] = c * 65536.0f;
+	matrix[5] = (-s * ox + c * oy + src_y) * 65536.0f;
+}
+
+// copy the frame buffer area of a sprite into its backing store (save = true) or back (save = false)
+void uVGA::sprite_copy_area(uvga_sprite_t *s, bool save)
+{
+	int x, y;
+	int w = s->saved_rect.x1 - s->saved_rect.x0 + 1;
+	uint8_t *store = s->save;
+	uint8_t *fb;
+
+	wait_idle_gfx_dma();
+
+	if(!save)
+		dirty_mark(s->saved_rect.x0, s->saved_rect.y0, s->saved_rect.x1, s->saved_rect.y1);
+
+	for(y = s->saved_rect.y0; y <= s->saved_rect.y1; y++)
+	{
+		if(fb_bpp == 8)
+		{
+			fb = frame_buffer + y * fb_row_stride + s->saved_rect.x0;
+
+			if(save)
+				memcpy(store, fb, w);
+			else
+				memcpy(fb, store, w);
+
+			store += w;
+		}
+		else
+		{
+			for(x = s->saved_rect.x0; x <= s->saved_rect.x1; x++)
+			{
+				if(save)
+					*store++ = getPixelFast(x, y);
+				else
+					putPixelFast(x, y, *store++);
+			}
+		}
+	}
+}
+
+// draw a RLE sprite (see uVGA_rle.h). Transparent runs are skipped without reading their pixels
+void uVGA::drawSprite(int16_t x_pos, int16_t y_pos, const uint8_t *rle)
+{
+	int w = uvga_rle_width(rle);
+	int h = uvga_rle_height(rle);
+	int y;
+	int x;
+	int x0, x1;			// visible part of a run
+	int skip;
+	int opaque;
+	int first_row;
+	int last_row;
+	const uint8_t *run;
+	uint8_t *fb_row;
+
+	// visible rows
+	first_row = (y_pos < 0) ? -y_pos : 0;
+	last_row = h - 1;
+	if((y_pos + last_row) >= fb_height)
+		last_row = fb_height - 1 - y_pos;
+
+	if((first_row > last_row) || ((x_pos + w) <= 0) || (x_pos >= fb_width))
+		return;
+
+	wait_idle_gfx_dma();
+
+	dirty_mark(x_pos, y_pos + first_row, x_pos + w - 1, y_pos + last_row);
+
+	for(y = first_row; y <= last_row; y++)
+	{
+		run = uvga_rle_row(rle, y);
+		fb_row = frame_buffer + (y_pos + y) * fb_row_stride;
+		x = x_pos;
+
+		while(x < (x_pos + w))
+		{
+			skip = *run++;
+			opaque = *run++;
+
+			x += skip;
+
+			// clip run to the frame buffer
+			x0 = (x < 0) ? 0 : x;
+			x1 = ((x + opaque) > fb_width) ? fb_width : x + opaque;
+
+			if(x0 < x1)
+			{
+				if(fb_bpp == 8)
+					memcpy(fb_row + x0, run + (x0 - x), x1 - x0);
+				else
+				{
+					for(; x0 < x1; x0++)
+						putPixelFast(x0, y_pos + y, run[x0 - x]);
+				}
+			}
+
+			run += opaque;
+			x += opaque;
+
+			// rest of the row is on the right of the frame buffer
+			if(x >= fb_width)
+				break;
+		}
+	}
+}
+
+
+
+#define SWAP(x,y) { (x)=(x)^(y); (y)=(x)^(y); (x)=(x)^(y); }
+
+// Fill a triangle - Bresenham method
+// Original from http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html
+void uVGA::fillTri(int x1, int y1, int x2, int y2, int x3, int y3, int color)
+{
+	int t1x, t2x, y, minx, maxx, t1xp, t2xp;
+	bool changed1 = false;
+	bool changed2 = false;
+	int signx1, signx2, dx1, dy1, dx2, dy2;
+	int e1, e2;
+
+	// Sort vertices
+	if (y1 > y2)
+	{
+		SWAP(y1, y2);
+		SWAP(x1, x2);
+	}
+
+	if (y1 > y3)
+	{
+		SWAP(y1, y3);
+		SWAP(x1, x3);
+	}
+
+	if (y2 > y3)
+	{
+		SWAP(y2, y3);
+		SWAP(x2, x3);
+	}
+
+	t1x = t2x = x1;
+	y = y1; // Starting points
+
+	dx1 = x2 - x1;
+
+	//delta_and_sign(x0, x1, &delta_x, &sign_x);
+	if(dx1 < 0)
+	{
+		dx1 = -dx1;
+		signx1 = -1;
+	}
+	else
+	{
+		signx1 = 1;
+	}
+
+	dy1 = y2 - y1;
+	dx2 = x3 - x1;
+
+	if(dx2 < 0)
+	{
+		dx2 = -dx2;
+		signx2 = -1;
+	}
+	else
+	{
+		signx2 = 1;
+	}
+
+	dy2 = y3 - y1;
+
+	if (dy1 > dx1)     // swap values
+	{
+		SWAP(dx1, dy1);
+		changed1 = true;
+	}
+
+	if (dy2 > dx2)     // swap values
+	{
+		SWAP(dy2, dx2);
+		changed2 = true;
+	}
+
+	e2 = dx2 >> 1;
+
+	// Flat top, just process the second half
+	if(y1 == y2)
+		goto next;
+
+	e1 = dx1 >> 1;
+
+	for (int i = 0; i < dx1;)
 	{
 		t1xp = 0;
 		t2xp = 0;
@@ -947,6 +1666,194 @@ void uVGA::fillEllipse(int x0, int y0, int x1, int y1, int color)
 	}
 }
 
+// ============================================================================
+// polygons
+// ============================================================================
+
+// Scanline rasterization with an active edge table: edges are sorted by first row, the edges crossing the current row are kept sorted by x.
+// Rows are sampled at pixel centers. An edge covers rows y_start to y_end (its last vertex row is excluded), a span covers the pixels
+// whose center is between 2 edges, so adjacent polygons sharing an edge never draw the same pixel twice (XOR raster operation).
+// Edge tables are in the polygon buffer: edges, then the active edge table (pointers).
+
+uvga_error_t uVGA::setPolygonBuffer(void *buffer, int size)
+{
+	if(poly_buffer_allocated)
+		free(poly_buffer);
+
+	poly_buffer = NULL;
+	poly_buffer_size = 0;
+	poly_buffer_allocated = false;
+
+	if(size <= 0)
+		return UVGA_OK;
+
+	if(buffer == NULL)
+	{
+		buffer = malloc(size);
+		if(buffer == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_POLYGON_BUFFER;
+
+		poly_buffer_allocated = true;
+	}
+
+	poly_buffer = (uint8_t *)buffer;
+	poly_buffer_size = size;
+
+	return UVGA_OK;
+}
+
+static int poly_edge_compare(const void *a, const void *b)
+{
+	return ((const uvga_poly_edge_t *)a)->y_start - ((const uvga_poly_edge_t *)b)->y_start;
+}
+
+uvga_error_t uVGA::fillPolygon(const int16_t *points, int nb_points, int color, uvga_fill_rule rule)
+{
+	uvga_poly_edge_t *edges;
+	uvga_poly_edge_t **aet;
+	uvga_poly_edge_t *e;
+	int nb_edges;
+	int nb_active;
+	int next_edge;
+	int i, j;
+	int x0, y0, x1, y1;
+	int y, y_max;
+	int min_x, max_x;
+	int winding;
+	int xs, xe;
+	int size;
+
+	if((points == NULL) || (nb_points < 3))
+		return UVGA_OK;
+
+	// the library buffer grows, a caller buffer is never replaced
+	size = UVGA_POLYGON_BUFFER_SIZE(nb_points);
+	if(size > poly_buffer_size)
+	{
+		if((poly_buffer != NULL) && !poly_buffer_allocated)
+			return UVGA_FAIL_TO_ALLOCATE_POLYGON_BUFFER;
+
+		if(setPolygonBuffer(NULL, size) != UVGA_OK)
+			return UVGA_FAIL_TO_ALLOCATE_POLYGON_BUFFER;
+	}
+
+	edges = (uvga_poly_edge_t *)poly_buffer;
+	aet = (uvga_poly_edge_t **)(poly_buffer + nb_points * sizeof(uvga_poly_edge_t));
+
+	// edge table, clipped to frame buffer rows
+	nb_edges = 0;
+	y_max = -1;
+	min_x = max_x = points[0];
+
+	for(i = 0; i < nb_points; i++)
+	{
+		j = (i == (nb_points - 1)) ? 0 : i + 1;
+
+		x0 = points[i * 2];
+		y0 = points[i * 2 + 1];
+		x1 = points[j * 2];
+		y1 = points[j * 2 + 1];
+
+		if(x0 < min_x)
+			min_x = x0;
+		if(x0 > max_x)
+			max_x = x0;
+
+		// horizontal edges never cross a row center
+		if(y0 == y1)
+			continue;
+
+		e = &edges[nb_edges];
+
+		if(y0 < y1)
+			e->winding = 1;
+		else
+		{
+			e->winding = -1;
+			SWAP(x0, x1);
+			SWAP(y0, y1);
+		}
+
+		if((y1 <= 0) || (y0 >= fb_height))
+			continue;
+
+		// position at the center of row y0, then at the center of the first visible row
+		e->dx = (int32_t)((((int64_t)(x1 - x0)) << 16) / (y1 - y0));
+		e->y_start = (y0 < 0) ? 0 : y0;
+		e->y_end = (y1 > fb_height) ? fb_height - 1 : y1 - 1;
+		e->x = (int32_t)((((int64_t)x0) << 16) + (e->dx >> 1) + (int64_t)(e->y_start - y0) * e->dx);
+
+		if(e->y_end > y_max)
+			y_max = e->y_end;
+
+		nb_edges++;
+	}
+
+	if(nb_edges == 0)
+		return UVGA_OK;
+
+	qsort(edges, nb_edges, sizeof(uvga_poly_edge_t), poly_edge_compare);
+
+	dirty_mark(min_x, edges[0].y_start, max_x, y_max);
+
+	nb_active = 0;
+	next_edge = 0;
+
+	for(y = edges[0].y_start; y <= y_max; y++)
+	{
+		// remove edges ending above this row, add edges starting on this row
+		for(i = 0, j = 0; i < nb_active; i++)
+		{
+			if(aet[i]->y_end >= y)
+				aet[j++] = aet[i];
+		}
+		nb_active = j;
+
+		while((next_edge < nb_edges) && (edges[next_edge].y_start == y))
+			aet[nb_active++] = &edges[next_edge++];
+
+		// keep active edges sorted by x. Order changes little from a row to the next, insertion sort is almost linear
+		for(i = 1; i < nb_active; i++)
+		{
+			e = aet[i];
+			for(j = i; (j > 0) && (aet[j - 1]->x > e->x); j--)
+				aet[j] = aet[j - 1];
+			aet[j] = e;
+		}
+
+		// spans between consecutive edges inside the polygon
+		winding = 0;
+		for(i = 0; i < (nb_active - 1); i++)
+		{
+			winding += (rule == UVGA_FILL_EVEN_ODD) ? 1 : aet[i]->winding;
+
+			if((rule == UVGA_FILL_EVEN_ODD) ? (winding & 1) : (winding != 0))
+			{
+				// pixels whose center is in [x_left, x_right[
+				xs = (aet[i]->x + 0x7FFF) >> 16;
+				xe = ((aet[i + 1]->x + 0x7FFF) >> 16) - 1;
+
+				if(xs < 0)
+					xs = 0;
+				if(xe >= fb_width)
+					xe = fb_width - 1;
+
+				if(xs <= xe)
+				{
+					wait_idle_gfx_dma();
+
+					drawHLineFast(y, xs, xe, color);
+				}
+			}
+		}
+
+		for(i = 0; i < nb_active; i++)
+			aet[i]->x += aet[i]->dx;
+	}
+
+	return UVGA_OK;
+}
+
 // copy area s_x,s_y of w*h pixels to destination d_x,d_y
 void uVGA::copy(int s_x, int s_y, int d_x, int d_y, int w, int h)
 {
@@ -991,7 +1898,7 @@ void uVGA::copy(int s_x, int s_y, int d_x, int d_y, int w, int h)
 	if(c_s_y < 0)
 	{
 		c_h += c_s_y;
-		c_d_x -= c_s_y;
+		c_d_y -= c_s_y;
 		c_s_y = 0;
 	}
 
@@ -1038,6 +1945,8 @@ void uVGA::copy(int s_x, int s_y, int d_x, int d_y, int w, int h)
 	if((c_w <= 0) || (c_h <= 0))
 		return;
 
+	dirty_mark(c_d_x, c_d_y, c_d_x + c_w - 1, c_d_y + c_h - 1);
+
 	if(c_d_y > c_s_y)
 	{
 		// copy from last line
@@ -1070,11 +1979,23 @@ void uVGA::copy(int s_x, int s_y, int d_x, int d_y, int w, int h)
 
 	wait_idle_gfx_dma();
 
+	// whole bytes (always the case in RGB332): rows are moved with memmove, which handles overlapping source and destination
+	if((raster_op == UVGA_ROP_COPY) && ((((c_s_x | c_d_x | c_w) << fb_bpp_shift) & 7) == 0))
+	{
+		for(off_y = 0; off_y < c_h; off_y++)
+		{
+			memmove(frame_buffer + (dypos + off_y * dy) * fb_row_stride + ((c_d_x << fb_bpp_shift) >> 3),
+					  frame_buffer + (sypos + off_y * dy) * fb_row_stride + ((c_s_x << fb_bpp_shift) >> 3),
+					  (c_w << fb_bpp_shift) >> 3);
+		}
+		return;
+	}
+
 	for(off_y = 0; off_y < c_h; off_y++)
 	{
 		for(off_x = 0; off_x < c_w; off_x++)
 		{
-			drawPixelFast(	dxpos + off_x * dx,
+			putPixelFast(	dxpos + off_x * dx,
 								dypos + off_y * dy,
 								getPixelFast(sxpos + off_x * dx,
 												 sypos + off_y * dy)
@@ -1085,12 +2006,15 @@ void uVGA::copy(int s_x, int s_y, int d_x, int d_y, int w, int h)
 
 void uVGA::scroll(int x, int y, int w, int h, int dx, int dy,int col)
 {
+	uvga_raster_op op = raster_op;
+
+	// empty area is filled with col, whatever the raster operation
+	raster_op = UVGA_ROP_COPY;
+
 	if(dy == 0)
 	{
-		if(dx == 0)
-			return;
-
-		Hscroll(x, y, w, h, dx, col);
+		if(dx != 0)
+			Hscroll(x, y, w, h, dx, col);
 	}
 	else if(dx == 0)
 	{
@@ -1103,6 +2027,7 @@ void uVGA::scroll(int x, int y, int w, int h, int dx, int dy,int col)
 #pragma message "multiscroll not finished, where should col pixel be put if source and destination area intersect ?"
 	}
 
+	raster_op = op;
 }
 
 inline void uVGA::Hscroll(int x, int y, int w, int h, int dx, int col)
@@ -1148,7 +2073,10 @@ void uVGA::init_text_settings()
 {
 	cursor_x = 0;
 	cursor_y = 0;
-	font_width = 8;		// font width != 8 is not supported
+	cursor_px = 0;
+	font = &uvga_font8x8;
+	font_scale = 1;
+	font_width = 8;
 	font_height = 8;
 	print_window_x = 0;
 	print_window_y = 0;
@@ -1160,78 +2088,506 @@ void uVGA::init_text_settings()
 	transparent_background = false;
 }
 
+// 4 glyph bits (MSB = leftmost pixel) => mask of 4 RGB332 pixels, pixels stored in increasing address order
+static const uint32_t glyph_nibble_mask[16] = {
+																0x00000000, 0xFF000000, 0x00FF0000, 0xFFFF0000,
+																0x0000FF00, 0xFF00FF00, 0x00FFFF00, 0xFFFFFF00,
+																0x000000FF, 0xFF0000FF, 0x00FF00FF, 0xFFFF00FF,
+																0x0000FFFF, 0xFF00FFFF, 0x00FFFFFF, 0xFFFFFFFF
+															};
+
 // print a text at a given coordinates. if bg_color = -1, background is transparent
 void uVGA::drawText(const char *text, int x, int y, int fg_col, int bg_col, uvga_text_direction dir)
 {
 	uint8_t t;
-	int i,j;
-	uint8_t *char_matrix;
-	uint8_t b;
-	uint8_t pix;
-
-	while((t = ((uint8_t)*text++)) != '\0')
-	{
-		char_matrix = &_vga_font8x8[t * font_height];
-
-		for(j = 0; j < font_height; j++)
-		{
-			b = *char_matrix++;
-
-			for(i = 0; i < font_width; i++)
-			{
-				pix = b & (128 >> i);
-
-				// pixel to draw or non transparent background color ?
-				if((pix) || (bg_col != -1))
-				{
-					switch(dir)
-					{
-						case UVGA_DIR_RIGHT:
-													drawPixel(x + i, y + j, (pix ? fg_col : bg_col));
-													break;
-
-						case UVGA_DIR_TOP:
-													drawPixel(x + j, y - i, (pix ? fg_col : bg_col));
-													break;
 
-						case UVGA_DIR_LEFT:
-													drawPixel(x - i, y - j, (pix ? fg_col : bg_col));
-													break;
+	int advance;
 
-						case UVGA_DIR_BOTTOM:
-													drawPixel(x - j, y + i, (pix ? fg_col : bg_col));
-													break;
+	wait_idle_gfx_dma();
 
-					}
-				}
-			}
-		}
+	while((t = ((uint8_t)*text++)) != '\0')
+	{
+		advance = drawChar(t, x, y, fg_col, bg_col, dir);
 
 		switch(dir)
 		{
 			case UVGA_DIR_RIGHT:
-											x += font_width;
+											x += advance;
 											break;
 
 			case UVGA_DIR_TOP:
-											y -= font_width;
+											y -= advance;
 											break;
 
 			case UVGA_DIR_LEFT:
-											x -= font_width;
+											x -= advance;
 											break;
 
 			case UVGA_DIR_BOTTOM:
-											y += font_width;
+											y += advance;
 											break;
 
 		}
 	}
 }
 
-void uVGA::moveCursor(int column, int line)
+// select the font used by text functions. NULL = default 8x8 font. The print window keeps its size in pixels
+void uVGA::setFont(const uvga_font_t *new_font, int scale)
 {
-	if(column < 0)
+	int w;
+	int h;
+
+	if(new_font == NULL)
+		new_font = &uvga_font8x8;
+
+	if(scale < 1)
+		scale = 1;
+
+	w = print_window_w * font_width;
+	h = print_window_h * font_height;
+
+	font = new_font;
+	font_scale = scale;
+	font_width = new_font->width * scale;
+	font_height = new_font->height * scale;
+
+	cursor_x = 0;
+	cursor_y = 0;
+	cursor_px = 0;
+
+	setPrintWindow(print_window_x, print_window_y, w, h);
+}
+
+// width in pixels of a character of the current font, 0 if the font has no glyph for it
+int uVGA::charWidth(uint8_t c)
+{
+	if((c < font->first_char) || (c > font->last_char))
+		return 0;
+
+	if(font->widths == NULL)
+		return font_width;
+
+	return font->widths[c - font->first_char] * font_scale;
+}
+
+// width in pixels of a text drawn with the current font
+int uVGA::textWidth(const char *text)
+{
+	int w = 0;
+
+	while(*text)
+		w += charWidth((uint8_t)*text++);
+
+	return w;
+}
+
+// draw a character of the current font, return its width in pixels
+int uVGA::drawChar(uint8_t c, int x, int y, int fg_col, int bg_col, uvga_text_direction dir)
+{
+	int index;
+	int w;
+	int pitch;
+	const uint8_t *glyph;
+
+	if((c < font->first_char) || (c > font->last_char))
+		return 0;
+
+	index = c - font->first_char;
+	w = (font->widths == NULL) ? font->width : font->widths[index];
+
+	// without offsets, all glyphs are stored font->width bits wide, even the narrower ones
+	if(font->offsets != NULL)
+	{
+		glyph = font->bitmap + font->offsets[index];
+		pitch = w;
+	}
+	else
+	{
+		glyph = font->bitmap + index * ((font->width * font->height + 7) >> 3);
+		pitch = font->width;
+	}
+
+	// 1 byte per glyph row: byte wide blitters and glyph cache
+	if((font->widths == NULL) && (font->width == 8) && (font_scale == 1))
+		drawGlyph(glyph, x, y, fg_col, bg_col, dir);
+	else
+		drawGlyphSpans(glyph, w, pitch, font->height, x, y, fg_col, bg_col, dir);
+
+	return w * font_scale;
+}
+
+// fill a rectangle of a glyph span, clipped to the frame buffer. x0 <= x1 and y0 <= y1
+inline void uVGA::glyph_fill_span(int x0, int y0, int x1, int y1, int color)
+{
+	if(x0 < 0)
+		x0 = 0;
+	if(y0 < 0)
+		y0 = 0;
+	if(x1 >= fb_width)
+		x1 = fb_width - 1;
+	if(y1 >= fb_height)
+		y1 = fb_height - 1;
+
+	if((x0 > x1) || (y0 > y1))
+		return;
+
+	dirty_mark(x0, y0, x1, y1);
+
+	if(x0 == x1)
+		drawVLineFast(x0, y0, y1, color);
+	else
+	{
+		for(; y0 <= y1; y0++)
+			drawHLineFast(y0, x0, x1, color);
+	}
+}
+
+// packed glyph of any size (h rows of pitch bits, rows are not byte aligned, MSB first), the w first bits of each row are drawn, scaled by font_scale
+// each run of identical bits of a glyph row is drawn as a single span
+void uVGA::drawGlyphSpans(const uint8_t *glyph, int w, int pitch, int h, int x, int y, int fg_col, int bg_col, uvga_text_direction dir)
+{
+	int i,j;
+	int run_start;
+	int run_bit;
+	int bit;
+	int bit_pos;
+	int s = font_scale;
+	int g0, g1;		// span along glyph row, in scaled pixels
+	int r0, r1;		// span across glyph rows
+
+	for(j = 0; j < h; j++)
+	{
+		run_start = 0;
+		run_bit = -1;
+		bit_pos = j * pitch;
+
+		for(i = 0; i <= w; i++, bit_pos++)
+		{
+			bit = (i < w) ? ((glyph[bit_pos >> 3] >> (7 - (bit_pos & 7))) & 1) : -1;
+
+			if(bit == run_bit)
+				continue;
+
+			// end of a run
+			if((run_bit == 1) || ((run_bit == 0) && (bg_col != -1)))
+			{
+				g0 = run_start * s;
+				g1 = i * s - 1;
+				r0 = j * s;
+				r1 = r0 + s - 1;
+
+				switch(dir)
+				{
+					case UVGA_DIR_RIGHT:
+													glyph_fill_span(x + g0, y + r0, x + g1, y + r1, run_bit ? fg_col : bg_col);
+													break;
+
+					case UVGA_DIR_TOP:
+													glyph_fill_span(x + r0, y - g1, x + r1, y - g0, run_bit ? fg_col : bg_col);
+													break;
+
+					case UVGA_DIR_LEFT:
+													glyph_fill_span(x - g1, y - r1, x - g0, y - r0, run_bit ? fg_col : bg_col);
+													break;
+
+					default:
+													glyph_fill_span(x - r1, y + g0, x - r0, y + g1, run_bit ? fg_col : bg_col);
+													break;
+				}
+			}
+
+			run_start = i;
+			run_bit = bit;
+		}
+	}
+}
+
+// draw a single glyph. The glyph rectangle is clipped once, fully visible RGB332 glyphs use the fast blitters
+// (x,y) is the position of the first pixel of the first glyph row, the glyph grows in the text direction
+void uVGA::drawGlyph(const uint8_t *glyph, int x, int y, int fg_col, int bg_col, uvga_text_direction dir)
+{
+	int x0, y0, x1, y1;		// glyph rectangle in frame buffer
+
+	switch(dir)
+	{
+		case UVGA_DIR_RIGHT:
+										x0 = x;
+										y0 = y;
+										x1 = x + font_width - 1;
+										y1 = y + font_height - 1;
+										break;
+
+		case UVGA_DIR_TOP:
+										x0 = x;
+										y0 = y - font_width + 1;
+										x1 = x + font_height - 1;
+										y1 = y;
+										break;
+
+		case UVGA_DIR_LEFT:
+										x0 = x - font_width + 1;
+										y0 = y - font_height + 1;
+										x1 = x;
+										y1 = y;
+										break;
+
+		default:
+										x0 = x - font_height + 1;
+										y0 = y;
+										x1 = x;
+										y1 = y + font_width - 1;
+										break;
+	}
+
+	// glyph outside of frame buffer ?
+	if((x1 < 0) || (y1 < 0) || (x0 >= fb_width) || (y0 >= fb_height))
+		return;
+
+	dirty_mark(x0, y0, x1, y1);
+
+	// glyph partially visible, packed pixels or raster operation
+	if((x0 < 0) || (y0 < 0) || (x1 >= fb_width) || (y1 >= fb_height) || (fb_bpp != 8) || (raster_op != UVGA_ROP_COPY))
+	{
+		drawGlyphClipped(glyph, x, y, clip_x(x0), clip_y(y0), clip_x(x1), clip_y(y1), fg_col, bg_col, dir);
+		return;
+	}
+
+	switch(dir)
+	{
+		case UVGA_DIR_RIGHT:
+										// opaque glyphs of the cached font size are copied from the glyph cache
+										if((glyph_cache != NULL) && (bg_col != -1) && (glyph_cache_tile_w == font_width) && (glyph_cache_tile_h == font_height))
+											drawGlyphTile(frame_buffer + y * fb_row_stride + x, glyph_cache_lookup(glyph, fg_col, bg_col));
+										else
+											drawGlyphRight(frame_buffer + y * fb_row_stride + x, glyph, fg_col, bg_col);
+										break;
+
+		case UVGA_DIR_TOP:
+										// glyph pixel (i,j) is at (x + j, y - i)
+										drawGlyphRotated(frame_buffer + y * fb_row_stride + x, -fb_row_stride, 1, glyph, fg_col, bg_col);
+										break;
+
+		case UVGA_DIR_LEFT:
+										// glyph pixel (i,j) is at (x - i, y - j)
+										drawGlyphRotated(frame_buffer + y * fb_row_stride + x, -1, -fb_row_stride, glyph, fg_col, bg_col);
+										break;
+
+		default:
+										// glyph pixel (i,j) is at (x - j, y + i)
+										drawGlyphRotated(frame_buffer + y * fb_row_stride + x, fb_row_stride, -1, glyph, fg_col, bg_col);
+										break;
+	}
+}
+
+// expand a glyph row byte into 8 RGB332 pixels with 2 nibble lookups and 2 32 bits writes. bg4 is not used if transparent
+static inline void glyph_store_row(uint8_t *dst, uint8_t b, uint32_t fg4, uint32_t bg4, bool transparent)
+{
+	uint32_t m0, m1;
+	uint32_t w0, w1;
+
+	// nothing to draw on transparent background
+	if(transparent && (b == 0))
+		return;
+
+	m0 = glyph_nibble_mask[b >> 4];
+	m1 = glyph_nibble_mask[b & 0xF];
+
+	// unaligned accesses are not allowed across SRAM_L/SRAM_U boundary, only aligned rows use 32 bits accesses
+	if((((int)dst) & 3) == 0)
+	{
+		if(transparent)
+		{
+			((uint32_t *)dst)[0] = (((uint32_t *)dst)[0] & ~m0) | (fg4 & m0);
+			((uint32_t *)dst)[1] = (((uint32_t *)dst)[1] & ~m1) | (fg4 & m1);
+		}
+		else
+		{
+			((uint32_t *)dst)[0] = (bg4 & ~m0) | (fg4 & m0);
+			((uint32_t *)dst)[1] = (bg4 & ~m1) | (fg4 & m1);
+		}
+		return;
+	}
+
+	if(transparent)
+	{
+		w0 = dst[0] | (dst[1] << 8) | (dst[2] << 16) | (dst[3] << 24);
+		w1 = dst[4] | (dst[5] << 8) | (dst[6] << 16) | (dst[7] << 24);
+		w0 = (w0 & ~m0) | (fg4 & m0);
+		w1 = (w1 & ~m1) | (fg4 & m1);
+	}
+	else
+	{
+		w0 = (bg4 & ~m0) | (fg4 & m0);
+		w1 = (bg4 & ~m1) | (fg4 & m1);
+	}
+
+	dst[0] = w0;
+	dst[1] = w0 >> 8;
+	dst[2] = w0 >> 16;
+	dst[3] = w0 >> 24;
+	dst[4] = w1;
+	dst[5] = w1 >> 8;
+	dst[6] = w1 >> 16;
+	dst[7] = w1 >> 24;
+}
+
+// unrotated RGB332 glyph WITHOUT clipping
+inline void uVGA::drawGlyphRight(uint8_t *dst, const uint8_t *glyph, int fg_col, int bg_col)
+{
+	int j;
+	uint32_t fg4 = (fg_col & 0xFF) * 0x01010101;
+	uint32_t bg4 = (bg_col & 0xFF) * 0x01010101;
+
+	for(j = 0; j < font_height; j++, dst += fb_row_stride)
+		glyph_store_row(dst, *glyph++, fg4, bg4, bg_col == -1);
+}
+
+// draw n characters on a line (UVGA_DIR_RIGHT) with the current font
+// with a fixed width 8 pixels font, a fully visible RGB332 run is drawn row by row: each frame buffer row of the run is written in one pass
+void uVGA::drawTextRun(const uint8_t *text, int n, int x, int y, int fg_col, int bg_col)
+{
+	int i,j;
+	int c;
+	uint8_t *dst;
+	uint8_t *ptr;
+	uint32_t fg4 = (fg_col & 0xFF) * 0x01010101;
+	uint32_t bg4 = (bg_col & 0xFF) * 0x01010101;
+	int glyph_size = (font->width * font->height + 7) >> 3;
+
+	wait_idle_gfx_dma();
+
+	// glyph cache, other fonts, packed pixels, raster operation or run crossing frame buffer border
+	if((glyph_cache != NULL) || (font->widths != NULL) || (font->offsets != NULL) || (font->width != 8) || (font_scale != 1) || (fb_bpp != 8) || (raster_op != UVGA_ROP_COPY)
+		|| (x < 0) || (y < 0) || ((x + n * 8) > fb_width) || ((y + font_height) > fb_height))
+	{
+		for(i = 0; i < n; i++)
+			x += drawChar(text[i], x, y, fg_col, bg_col, UVGA_DIR_RIGHT);
+		return;
+	}
+
+	dirty_mark(x, y, x + n * 8 - 1, y + font_height - 1);
+
+	dst = frame_buffer + y * fb_row_stride + x;
+
+	for(j = 0; j < font_height; j++, dst += fb_row_stride)
+	{
+		ptr = dst;
+
+		for(i = 0; i < n; i++, ptr += 8)
+		{
+			c = text[i];
+
+			// character without glyph is blank
+			if((c < font->first_char) || (c > font->last_char))
+				glyph_store_row(ptr, 0, fg4, bg4, bg_col == -1);
+			else
+				glyph_store_row(ptr, font->bitmap[(c - font->first_char) * glyph_size + j], fg4, bg4, bg_col == -1);
+		}
+	}
+}
+
+// copy an expanded glyph WITHOUT clipping. Tiles start on a 32 bits boundary and their rows are font_width bytes long,
+// rows are only 32 bits aligned when font_width is a multiple of 4 (otherwise they are copied with memcpy)
+inline void uVGA::drawGlyphTile(uint8_t *dst, const uint8_t *tile)
+{
+	int i,j;
+	const uint32_t *src = (const uint32_t *)tile;
+
+	for(j = 0; j < font_height; j++, dst += fb_row_stride)
+	{
+		// unaligned accesses are not allowed across SRAM_L/SRAM_U boundary
+		if(((((int)dst) & 3) == 0) && ((font_width & 3) == 0))
+		{
+			for(i = 0; i < font_width; i += 4)
+				*(uint32_t *)(dst + i) = *src++;
+		}
+		else
+		{
+			memcpy(dst, src, font_width);
+			src = (const uint32_t *)(((const uint8_t *)src) + font_width);
+		}
+	}
+}
+
+// rotated RGB332 glyph WITHOUT clipping. step_i is the frame buffer offset between 2 pixels of a glyph row, step_j between 2 glyph rows
+inline void uVGA::drawGlyphRotated(uint8_t *dst, int step_i, int step_j, const uint8_t *glyph, int fg_col, int bg_col)
+{
+	int i,j;
+	uint8_t *ptr;
+	uint8_t b;
+
+	for(j = 0; j < font_height; j++, dst += step_j)
+	{
+		b = *glyph++;
+		ptr = dst;
+
+		if(bg_col == -1)
+		{
+			// transparent background: only set pixels are written
+			for(i = 0; b != 0; i++, ptr += step_i, b <<= 1)
+			{
+				if(b & 0x80)
+					*ptr = fg_col;
+			}
+		}
+		else
+		{
+			for(i = 0; i < font_width; i++, ptr += step_i, b <<= 1)
+				*ptr = (b & 0x80) ? fg_col : bg_col;
+		}
+	}
+}
+
+// glyph crossing frame buffer border, packed pixels or raster operation. Only pixels inside (x0,y0)-(x1,y1) are drawn
+void uVGA::drawGlyphClipped(const uint8_t *glyph, int x, int y, int x0, int y0, int x1, int y1, int fg_col, int bg_col, uvga_text_direction dir)
+{
+	int i,j;
+	int px, py;
+	int dx_i, dy_i;		// move of 1 pixel in a glyph row
+	int dx_j, dy_j;		// move of 1 glyph row
+	uint8_t b;
+
+	switch(dir)
+	{
+		case UVGA_DIR_RIGHT:
+										dx_i = 1; dy_i = 0; dx_j = 0; dy_j = 1;
+										break;
+
+		case UVGA_DIR_TOP:
+										dx_i = 0; dy_i = -1; dx_j = 1; dy_j = 0;
+										break;
+
+		case UVGA_DIR_LEFT:
+										dx_i = -1; dy_i = 0; dx_j = 0; dy_j = -1;
+										break;
+
+		default:
+										dx_i = 0; dy_i = 1; dx_j = -1; dy_j = 0;
+										break;
+	}
+
+	for(j = 0; j < font_height; j++)
+	{
+		b = *glyph++;
+		px = x + j * dx_j;
+		py = y + j * dy_j;
+
+		for(i = 0; i < font_width; i++, px += dx_i, py += dy_i, b <<= 1)
+		{
+			if((px < x0) || (px > x1) || (py < y0) || (py > y1))
+				continue;
+
+			if(b & 0x80)
+				drawPixelFast(px, py, fg_col);
+			else if(bg_col != -1)
+				drawPixelFast(px, py, bg_col);
+		}
+	}
+}
+
+void uVGA::moveCursor(int column, int line)
+{
+	if(column < 0)
 		cursor_x = 0;
 	else if(column >= print_window_w)
 		cursor_x = print_window_w - 1;
@@ -1244,6 +2600,8 @@ void uVGA::moveCursor(int column, int line)
 		cursor_y = print_window_h - 1;
 	else
 		cursor_y = line;
+
+	cursor_px = cursor_x * font_width;
 }
 
 // define printing window, width and height are in pixel
@@ -1271,13 +2629,25 @@ void uVGA::setPrintWindow(int x, int y, int width, int height)
 
 	print_window_w = width / font_width;
 	print_window_h = height / font_height;
+
+	if(text_cells != NULL)
+		enableTextMode();
 }
 
 void uVGA::clearPrintWindow()
 {
+	if(text_cells != NULL)
+	{
+		text_clear();
+		cursor_x = 0;
+		cursor_y = 0;
+		return;
+	}
+
 	fillRect(print_window_x, print_window_y, print_window_x + print_window_w * font_width - 1, print_window_y + print_window_h * font_height - 1, background_color);
 	cursor_x = 0;
 	cursor_y = 0;
+	cursor_px = 0;
 }
 
 void uVGA::unsetPrintWindow()
@@ -1286,17 +2656,165 @@ void uVGA::unsetPrintWindow()
 	print_window_y = 0;
 	print_window_w = fb_width / font_width;
 	print_window_h = fb_height / font_height;
+
+	if(text_cells != NULL)
+		enableTextMode();
 }
 
 void uVGA::scrollPrintWindow()
 {
-	// move the 2nd line and the following ones one line up
-	Vscroll(print_window_x, print_window_y + font_height, 
-			print_window_w * font_width, (print_window_h - 1) * font_height, 
-			-font_height,
+	scroll_print_window_lines(1);
+}
+
+// move the content of the print window nb_lines lines up, with a single copy
+void uVGA::scroll_print_window_lines(int nb_lines)
+{
+	if(nb_lines <= 0)
+		return;
+
+	if(text_cells != NULL)
+	{
+		while(nb_lines--)
+			text_scroll();
+		return;
+	}
+
+	// all lines disappear
+	if(nb_lines >= print_window_h)
+	{
+		fillRect(print_window_x, print_window_y, print_window_x + print_window_w * font_width - 1, print_window_y + print_window_h * font_height - 1, background_color);
+		return;
+	}
+
+	// move the (nb_lines + 1)th line and the following ones nb_lines lines up
+	scroll(print_window_x, print_window_y + nb_lines * font_height, 
+			print_window_w * font_width, (print_window_h - nb_lines) * font_height, 
+			0, -nb_lines * font_height,
 			background_color);
 }
 
+// move lines top to bottom of the print window nb_lines lines up (nb_lines > 0) or down (nb_lines < 0). Other lines are not modified
+void uVGA::scroll_print_window_region(int top, int bottom, int nb_lines)
+{
+	int h = bottom - top + 1;
+	int n = (nb_lines < 0) ? -nb_lines : nb_lines;
+
+	if((nb_lines == 0) || (h <= 0))
+		return;
+
+	// whole window scrolled up: fastest path (text mode grid rotation)
+	if((top == 0) && (bottom == (print_window_h - 1)) && (nb_lines > 0))
+	{
+		scroll_print_window_lines(nb_lines);
+		return;
+	}
+
+	if(text_cells != NULL)
+	{
+		text_scroll_region(top, bottom, nb_lines);
+		return;
+	}
+
+	// all lines of the region disappear
+	if(n >= h)
+	{
+		erase_print_window_lines(top, bottom);
+		return;
+	}
+
+	if(nb_lines > 0)
+	{
+		scroll(print_window_x, print_window_y + (top + n) * font_height,
+				print_window_w * font_width, (h - n) * font_height,
+				0, -n * font_height,
+				background_color);
+	}
+	else
+	{
+		scroll(print_window_x, print_window_y + top * font_height,
+				print_window_w * font_width, (h - n) * font_height,
+				0, n * font_height,
+				background_color);
+	}
+}
+
+// move characters of a line from column to the end of the line nb_chars columns right (nb_chars > 0) or left (nb_chars < 0)
+void uVGA::shift_print_window_chars(int line, int column, int nb_chars)
+{
+	int w = print_window_w - column;
+	int n = (nb_chars < 0) ? -nb_chars : nb_chars;
+
+	if((nb_chars == 0) || (w <= 0))
+		return;
+
+	if(text_cells != NULL)
+	{
+		text_shift_line(line, column, nb_chars);
+		return;
+	}
+
+	if(n >= w)
+	{
+		erase_print_window_chars(line, column, print_window_w - 1);
+		return;
+	}
+
+	if(nb_chars > 0)
+	{
+		scroll(print_window_x + column * font_width, print_window_y + line * font_height,
+				(w - n) * font_width, font_height,
+				n * font_width, 0,
+				background_color);
+	}
+	else
+	{
+		scroll(print_window_x + (column + n) * font_width, print_window_y + line * font_height,
+				(w - n) * font_width, font_height,
+				-n * font_width, 0,
+				background_color);
+	}
+}
+
+// fill characters first_column to last_column of a line with background color
+void uVGA::erase_print_window_chars(int line, int first_column, int last_column)
+{
+	int column;
+
+	if(first_column > last_column)
+		return;
+
+	if(text_cells != NULL)
+	{
+		for(column = first_column; column <= last_column; column++)
+			text_set_cell(column, line, ' ', foreground_color, transparent_background ? -1 : background_color);
+		return;
+	}
+
+	fillRect(print_window_x + first_column * font_width, print_window_y + line * font_height,
+				print_window_x + (last_column + 1) * font_width - 1, print_window_y + (line + 1) * font_height - 1,
+				background_color);
+}
+
+// fill lines first_line to last_line with background color
+void uVGA::erase_print_window_lines(int first_line, int last_line)
+{
+	int line;
+
+	if(first_line > last_line)
+		return;
+
+	if(text_cells != NULL)
+	{
+		for(line = first_line; line <= last_line; line++)
+			erase_print_window_chars(line, 0, print_window_w - 1);
+		return;
+	}
+
+	fillRect(print_window_x, print_window_y + first_line * font_height,
+				print_window_x + print_window_w * font_width - 1, print_window_y + (last_line + 1) * font_height - 1,
+				background_color);
+}
+
 
 void uVGA::setForegroundColor(uint8_t fg_color)   // RGB332 format
 {
@@ -1318,14 +2836,19 @@ size_t uVGA::write(uint8_t c)
 {
 	char buf[2];
 
+	if(term_enabled)
+		return terminal_write(c);
+
 	switch(c)
 	{
 		case '\r':
 						cursor_x = 0;
+						cursor_px = 0;
 						return 1;
 
 		case '\n':
 						cursor_x = 0;
+						cursor_px = 0;
 						cursor_y ++;
 
 						if(cursor_y >= print_window_h)
@@ -1336,6 +2859,17 @@ size_t uVGA::write(uint8_t c)
 						return 1;
 
 		case '\t':
+						// proportional font: move to the next multiple of 8 widest characters
+						if((font->widths != NULL) && (text_cells == NULL))
+						{
+							cursor_px = (cursor_px / (font_width * 8) + 1) * font_width * 8;
+							cursor_x = cursor_px / font_width;
+
+							if(cursor_px >= (print_window_w * font_width))
+								write('\n');
+							return 1;
+						}
+
 						write(' ');
 
 						if(print_window_w >= 8)	// prevent neverending loop if print window width is too small to contain a TAB
@@ -1350,21 +2884,109 @@ size_t uVGA::write(uint8_t c)
 					if(cursor_x >= print_window_w)
 						write('\n');
 
+					if(text_cells != NULL)
+					{
+						text_set_cell(cursor_x, cursor_y, c, foreground_color, transparent_background ? -1 : background_color);
+						cursor_x++;
+						return 1;
+					}
+
+					// proportional font: cursor position is in pixels
+					if(font->widths != NULL)
+					{
+						int advance = charWidth(c);
+
+						if((cursor_px + advance) > (print_window_w * font_width))
+							write('\n');
+
+						wait_idle_gfx_dma();
+						drawChar(c, print_window_x + cursor_px, print_window_y + cursor_y * font_height, foreground_color, transparent_background ? -1 : background_color, UVGA_DIR_RIGHT);
+						cursor_px += advance;
+						cursor_x = cursor_px / font_width;
+						return 1;
+					}
+
 					buf[0] = c;
 					buf[1] = '\0';
 
-					drawText(buf, print_window_x + cursor_x * font_width, print_window_y + cursor_y * font_height, foreground_color, background_color, UVGA_DIR_RIGHT);
+					drawText(buf, print_window_x + cursor_x * font_width, print_window_y + cursor_y * font_height, foreground_color, transparent_background ? -1 : background_color, UVGA_DIR_RIGHT);
 					cursor_x++;
 					return 1;
 	}
 }
 
+// the buffer is parsed in runs: consecutive line breaks produce a single scroll, consecutive characters of a line are drawn together
 size_t uVGA::write(const uint8_t *buffer, size_t size)
 {
 	size_t i;
+	int n;
+	int nb_lines;
+	uint8_t c;
+
+	if(term_enabled)
+		return terminal_write(buffer, size);
+
+	// text mode only updates cells, proportional fonts wrap on pixel width
+	if((text_cells != NULL) || (font->widths != NULL))
+	{
+		for(i = 0; i < size; i++)
+			write(buffer[i]);
+
+		return size;
+	}
+
+	i = 0;
+	while(i < size)
+	{
+		c = buffer[i];
 
-	for(i = 0; i < size; i++)
-		write(buffer[i]);
+		if((c == '\r') || (c == '\n'))
+		{
+			// count line breaks of the run
+			nb_lines = 0;
+			while((i < size) && ((buffer[i] == '\r') || (buffer[i] == '\n')))
+			{
+				if(buffer[i] == '\n')
+					nb_lines++;
+				i++;
+			}
+
+			cursor_x = 0;
+			cursor_px = 0;
+			cursor_y += nb_lines;
+
+			if(cursor_y >= print_window_h)
+			{
+				scroll_print_window_lines(cursor_y - print_window_h + 1);
+				cursor_y = print_window_h - 1;
+			}
+			continue;
+		}
+
+		if(c == '\t')
+		{
+			write(c);
+			i++;
+			continue;
+		}
+
+		// not enough space on the line ?
+		if(cursor_x >= print_window_w)
+			write('\n');
+
+		// characters until the end of the line or the next control character
+		for(n = 0; ((i + n) < size) && (n < (print_window_w - cursor_x)); n++)
+		{
+			c = buffer[i + n];
+			if((c == '\r') || (c == '\n') || (c == '\t'))
+				break;
+		}
+
+		drawTextRun(buffer + i, n, print_window_x + cursor_x * font_width, print_window_y + cursor_y * font_height, foreground_color, transparent_background ? -1 : background_color);
+
+		cursor_x += n;
+		i += n;
+	}
 
 	return size;
 }
@@ -0,0 +1,227 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Glyph cache
+
+// Each entry holds a glyph already expanded into RGB332 pixels for a (glyph, foreground, background) triplet.
+// Drawing a cached glyph is a copy of font_height rows of font_width bytes. Only opaque glyphs in RGB332 mode are cached.
+
+// Entries are in a doubly linked list sorted by last use (head = most recently used, tail = next entry to reuse)
+// and in hash chains to find a triplet without scanning the whole cache.
+
+// ============================================================================
+static inline int glyph_cache_hash(const uint8_t *glyph, uint8_t fg, uint8_t bg, int mask)
+{
+	uint32_t h = ((uint32_t)glyph) ^ (fg << 8) ^ (bg << 16);
+
+	h ^= h >> 11;
+	h *= 0x9E3779B1;
+
+	return (h >> 16) & mask;
+}
+
+// ============================================================================
+// allocate a cache of nb_entries glyphs of the current font. 0 frees the cache
+uvga_error_t uVGA::setGlyphCache(int nb_entries)
+{
+	int i;
+
+	if(glyph_cache != NULL)
+	{
+		free(glyph_cache);
+		free(glyph_cache_tiles);
+		free(glyph_cache_buckets);
+		glyph_cache = NULL;
+		glyph_cache_tiles = NULL;
+		glyph_cache_buckets = NULL;
+	}
+
+	glyph_cache_hits = 0;
+	glyph_cache_misses = 0;
+
+	if(nb_entries <= 0)
+		return UVGA_OK;
+
+	if(nb_entries > 32767)
+		nb_entries = 32767;
+
+	// number of buckets is a power of 2, at least the number of entries
+	for(glyph_cache_bucket_mask = 1; glyph_cache_bucket_mask < nb_entries; glyph_cache_bucket_mask <<= 1);
+
+	glyph_cache_tile_w = font_width;
+	glyph_cache_tile_h = font_height;
+	glyph_cache_tile_size = (font_width * font_height + 3) & ~3;	// tiles are 4 bytes aligned
+
+	glyph_cache = (uvga_glyph_cache_entry_t *) malloc(sizeof(uvga_glyph_cache_entry_t) * nb_entries);
+	glyph_cache_tiles = (uint8_t *) malloc(glyph_cache_tile_size * nb_entries);
+	glyph_cache_buckets = (short *) malloc(sizeof(short) * glyph_cache_bucket_mask);
+
+	if((glyph_cache == NULL) || (glyph_cache_tiles == NULL) || (glyph_cache_buckets == NULL))
+	{
+		if(glyph_cache != NULL)
+			free(glyph_cache);
+		if(glyph_cache_tiles != NULL)
+			free(glyph_cache_tiles);
+		if(glyph_cache_buckets != NULL)
+			free(glyph_cache_buckets);
+
+		glyph_cache = NULL;
+		glyph_cache_tiles = NULL;
+		glyph_cache_buckets = NULL;
+		return UVGA_FAIL_TO_ALLOCATE_GLYPH_CACHE;
+	}
+
+	glyph_cache_bucket_mask--;
+	glyph_cache_nb_entries = nb_entries;
+
+	for(i = 0; i <= glyph_cache_bucket_mask; i++)
+		glyph_cache_buckets[i] = -1;
+
+	// all entries are free, in LRU order 0, 1, 2...
+	for(i = 0; i < nb_entries; i++)
+	{
+		glyph_cache[i].glyph = NULL;
+		glyph_cache[i].prev = i - 1;
+		glyph_cache[i].next = (i == (nb_entries - 1)) ? -1 : i + 1;
+		glyph_cache[i].hash_next = -1;
+	}
+
+	glyph_cache_head = 0;
+	glyph_cache_tail = nb_entries - 1;
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+void uVGA::getGlyphCacheStats(uint32_t *hits, uint32_t *misses, bool reset)
+{
+	if(hits != NULL)
+		*hits = glyph_cache_hits;
+
+	if(misses != NULL)
+		*misses = glyph_cache_misses;
+
+	if(reset)
+	{
+		glyph_cache_hits = 0;
+		glyph_cache_misses = 0;
+	}
+}
+
+// ============================================================================
+// move an entry to the head of the LRU list
+inline void uVGA::glyph_cache_touch(int e)
+{
+	uvga_glyph_cache_entry_t *entry = &glyph_cache[e];
+
+	if(e == glyph_cache_head)
+		return;
+
+	// unlink
+	glyph_cache[entry->prev].next = entry->next;
+	if(entry->next != -1)
+		glyph_cache[entry->next].prev = entry->prev;
+	else
+		glyph_cache_tail = entry->prev;
+
+	// insert at head
+	entry->prev = -1;
+	entry->next = glyph_cache_head;
+	glyph_cache[glyph_cache_head].prev = e;
+	glyph_cache_head = e;
+}
+
+// ============================================================================
+// remove an entry from its hash chain
+inline void uVGA::glyph_cache_unhash(int e)
+{
+	short *link;
+
+	link = &glyph_cache_buckets[glyph_cache_hash(glyph_cache[e].glyph, glyph_cache[e].fg, glyph_cache[e].bg, glyph_cache_bucket_mask)];
+
+	while(*link != -1)
+	{
+		if(*link == e)
+		{
+			*link = glyph_cache[e].hash_next;
+			return;
+		}
+
+		link = &glyph_cache[*link].hash_next;
+	}
+}
+
+// ============================================================================
+// return the expanded pixels of a glyph, expand it in the least recently used entry if it is not in the cache
+const uint8_t *uVGA::glyph_cache_lookup(const uint8_t *glyph, uint8_t fg, uint8_t bg)
+{
+	int h;
+	int e;
+	int i,j;
+	uint8_t b;
+	uint8_t *tile;
+	uvga_glyph_cache_entry_t *entry;
+
+	h = glyph_cache_hash(glyph, fg, bg, glyph_cache_bucket_mask);
+
+	for(e = glyph_cache_buckets[h]; e != -1; e = glyph_cache[e].hash_next)
+	{
+		entry = &glyph_cache[e];
+
+		if((entry->glyph == glyph) && (entry->fg == fg) && (entry->bg == bg))
+		{
+			glyph_cache_hits++;
+			glyph_cache_touch(e);
+			return glyph_cache_tiles + e * glyph_cache_tile_size;
+		}
+	}
+
+	glyph_cache_misses++;
+
+	// reuse the least recently used entry
+	e = glyph_cache_tail;
+	entry = &glyph_cache[e];
+
+	if(entry->glyph != NULL)
+		glyph_cache_unhash(e);
+
+	entry->glyph = glyph;
+	entry->fg = fg;
+	entry->bg = bg;
+	entry->hash_next = glyph_cache_buckets[h];
+	glyph_cache_buckets[h] = e;
+
+	glyph_cache_touch(e);
+
+	tile = glyph_cache_tiles + e * glyph_cache_tile_size;
+
+	for(j = 0; j < glyph_cache_tile_h; j++)
+	{
+		b = *glyph++;
+
+		for(i = 0; i < glyph_cache_tile_w; i++, b <<= 1)
+			*tile++ = (b & 0x80) ? fg : bg;
+	}
+
+	return glyph_cache_tiles + e * glyph_cache_tile_size;
+}
@@ -0,0 +1,107 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA_image.h"
+
+// compressed image encoder, see uVGA_image.h for the format. Only depends on stdint.h
+
+// ============================================================================
+// write a byte if there is enough room
+static inline void image_put(uint8_t *image, int image_size, int pos, uint8_t value)
+{
+	if((image != NULL) && (pos < image_size))
+		image[pos] = value;
+}
+
+// number of identical pixels starting at row[x], at most max
+static inline int image_run_length(const uint8_t *row, int x, int width, int max)
+{
+	int n;
+
+	for(n = 1; ((x + n) < width) && (n < max) && (row[x + n] == row[x]); n++);
+
+	return n;
+}
+
+// ============================================================================
+int uvga_image_encode(const uint8_t *bitmap, int width, int height, uint8_t *image, int image_size)
+{
+	int x, y;
+	int pos;
+	int n;
+	int literal;
+	const uint8_t *row;
+
+	if((width <= 0) || (height <= 0) || (width > 65535) || (height > 65535))
+		return -1;
+
+	image_put(image, image_size, 0, 'U');
+	image_put(image, image_size, 1, 'I');
+	image_put(image, image_size, 2, width);
+	image_put(image, image_size, 3, width >> 8);
+	image_put(image, image_size, 4, height);
+	image_put(image, image_size, 5, height >> 8);
+
+	pos = UVGA_IMAGE_HEADER_SIZE;
+
+	for(y = 0; y < height; y++)
+	{
+		row = bitmap + y * width;
+
+		x = 0;
+		while(x < width)
+		{
+			n = image_run_length(row, x, width, UVGA_IMAGE_LONG_RUN_MAX);
+
+			if(n >= UVGA_IMAGE_SHORT_RUN_MIN)
+			{
+				if(n <= UVGA_IMAGE_SHORT_RUN_MAX)
+					image_put(image, image_size, pos++, 0x80 | (n - UVGA_IMAGE_SHORT_RUN_MIN));
+				else
+				{
+					image_put(image, image_size, pos++, 0xC0 | ((n - 1) >> 8));
+					image_put(image, image_size, pos++, n - 1);
+				}
+
+				image_put(image, image_size, pos++, row[x]);
+				x += n;
+				continue;
+			}
+
+			// literal pixels until a run is long enough to be encoded as a run
+			for(literal = 0; ((x + literal) < width) && (literal < UVGA_IMAGE_LITERAL_MAX); literal++)
+			{
+				if(image_run_length(row, x + literal, width, UVGA_IMAGE_SHORT_RUN_MIN) >= UVGA_IMAGE_SHORT_RUN_MIN)
+					break;
+			}
+
+			image_put(image, image_size, pos++, literal - 1);
+
+			for(; literal > 0; literal--)
+				image_put(image, image_size, pos++, row[x++]);
+		}
+	}
+
+	if((image != NULL) && (pos > image_size))
+		return -1;
+
+	return pos;
+}
@@ -0,0 +1,70 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#ifndef _UVGA_IMAGE_H
+#define _UVGA_IMAGE_H
+
+// Compressed image format (1 byte per pixel: RGB332 or palette index). This file does not depend on Teensy and can be used to encode images on a computer
+
+// all values are little endian
+// offset 0: 'U', 'I'
+// offset 2: width (16 bits)
+// offset 4: height (16 bits)
+// offset 6: rows, one after the other. A row is a sequence of codes, the row ends when the sum of code lengths reaches the width
+//
+// codes:
+// 0nnnnnnn                     n + 1 literal pixels follow (1 to 128)
+// 10nnnnnn c                   n + 3 pixels of color c (3 to 66)
+// 11nnnnnn nnnnnnnn c          n + 1 pixels of color c (1 to 16384), n is 14 bits, most significant bits in the first byte
+//
+// runs never cross rows: a row can be decoded, clipped or skipped without the others
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define UVGA_IMAGE_HEADER_SIZE		6
+
+#define UVGA_IMAGE_LITERAL_MAX		128
+#define UVGA_IMAGE_SHORT_RUN_MIN		3
+#define UVGA_IMAGE_SHORT_RUN_MAX		66
+#define UVGA_IMAGE_LONG_RUN_MAX		16384
+
+// encode a bitmap (1 byte per pixel)
+// return the size of the encoded image. If image is NULL, nothing is written (size computation only). Return -1 if image_size is too small
+int uvga_image_encode(const uint8_t *bitmap, int width, int height, uint8_t *image, int image_size);
+
+// header check and image size
+static inline int uvga_image_valid(const uint8_t *image)
+{
+	return (image[0] == 'U') && (image[1] == 'I');
+}
+
+static inline int uvga_image_width(const uint8_t *image)
+{
+	return image[2] | (image[3] << 8);
+}
+
+static inline int uvga_image_height(const uint8_t *image)
+{
+	return image[4] | (image[5] << 8);
+}
+
+#endif
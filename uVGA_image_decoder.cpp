@@ -0,0 +1,239 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Compressed image decoder (format in uVGA_image.h)
+
+// Codes are decoded directly in frame buffer rows: literal pixels are copied and runs are filled with memcpy()/memset(),
+// there is no intermediate row. Rows above the visible area are decoded without being drawn, decoding stops after the last visible row.
+// Images in memory (RAM or flash) are read in place. Streamed images are read by blocks of UVGA_IMAGE_STREAM_BUFFER bytes on the stack.
+
+typedef struct
+{
+	const uint8_t *ptr;
+	const uint8_t *end;
+	uvga_image_read_callback_t read;	// NULL: image in memory, no data after end
+	void *context;
+	uint8_t *buffer;
+} image_source;
+
+// ============================================================================
+// number of bytes available without reading, at least 1. Return 0 at end of data
+static inline int image_available(image_source *s, int wanted)
+{
+	int n;
+
+	if(s->ptr == s->end)
+	{
+		if(s->read == NULL)
+			return 0;
+
+		n = s->read(s->context, s->buffer, UVGA_IMAGE_STREAM_BUFFER);
+		if(n <= 0)
+			return 0;
+
+		s->ptr = s->buffer;
+		s->end = s->buffer + n;
+	}
+
+	n = s->end - s->ptr;
+	return (n < wanted) ? n : wanted;
+}
+
+// next byte or -1 at end of data
+static inline int image_get(image_source *s)
+{
+	if(image_available(s, 1) == 0)
+		return -1;
+
+	return *s->ptr++;
+}
+
+// ============================================================================
+uvga_error_t uVGA::drawImage(int x, int y, const uint8_t *image, int image_size, const uvga_rect_t *clip)
+{
+	if((image == NULL) || (image_size <= 0))
+		return UVGA_INVALID_IMAGE;
+
+	return image_decode(x, y, image, image_size, NULL, NULL, clip);
+}
+
+uvga_error_t uVGA::drawImageStream(int x, int y, uvga_image_read_callback_t read, void *context, const uvga_rect_t *clip)
+{
+	if(read == NULL)
+		return UVGA_INVALID_IMAGE;
+
+	return image_decode(x, y, NULL, 0, read, context, clip);
+}
+
+// ============================================================================
+// draw n pixels of an image row starting at frame buffer column x, only columns clip_x0 to clip_x1 are modified
+// src = NULL: run of color, otherwise literal pixels
+inline void uVGA::image_span(uint8_t *fb_row, int y, int x, int n, const uint8_t *src, int color, int clip_x0, int clip_x1)
+{
+	int x0 = (x < clip_x0) ? clip_x0 : x;
+	int x1 = ((x + n - 1) > clip_x1) ? clip_x1 : x + n - 1;
+
+	if((fb_row == NULL) || (x0 > x1))
+		return;
+
+	if(fb_bpp == 8)
+	{
+		if(src != NULL)
+			memcpy(fb_row + x0, src + (x0 - x), x1 - x0 + 1);
+		else
+			memset(fb_row + x0, color, x1 - x0 + 1);
+		return;
+	}
+
+	// palette modes, pixels are palette indexes
+	for(; x0 <= x1; x0++)
+		store_pixel(x0, y, (src != NULL) ? src[x0 - x] : color);
+}
+
+// ============================================================================
+// decode an image of image_size bytes in memory (image != NULL) or from a read callback
+uvga_error_t uVGA::image_decode(int x, int y, const uint8_t *image, int image_size, uvga_image_read_callback_t read, void *context, const uvga_rect_t *clip)
+{
+	uint8_t buffer[UVGA_IMAGE_STREAM_BUFFER];
+	uint8_t header[UVGA_IMAGE_HEADER_SIZE];
+	image_source s;
+	int w, h;
+	int cx0, cy0, cx1, cy1;		// modified area
+	int i, j;
+	int code;
+	int n, k;
+	int color;
+	uint8_t *fb_row;
+
+	s.ptr = image;
+	s.end = image + image_size;
+	s.read = read;
+	s.context = context;
+	s.buffer = buffer;
+
+	if(image == NULL)
+	{
+		s.ptr = buffer;
+		s.end = buffer;
+	}
+
+	for(i = 0; i < UVGA_IMAGE_HEADER_SIZE; i++)
+	{
+		if((code = image_get(&s)) < 0)
+			return UVGA_INVALID_IMAGE;
+
+		header[i] = code;
+	}
+
+	if(!uvga_image_valid(header))
+		return UVGA_INVALID_IMAGE;
+
+	w = uvga_image_width(header);
+	h = uvga_image_height(header);
+
+	// modified area: image, frame buffer and clip rectangle
+	cx0 = x;
+	cy0 = y;
+	cx1 = x + w - 1;
+	cy1 = y + h - 1;
+
+	if(clip != NULL)
+	{
+		if(cx0 < clip->x0)
+			cx0 = clip->x0;
+		if(cy0 < clip->y0)
+			cy0 = clip->y0;
+		if(cx1 > clip->x1)
+			cx1 = clip->x1;
+		if(cy1 > clip->y1)
+			cy1 = clip->y1;
+	}
+
+	if(cx0 < 0)
+		cx0 = 0;
+	if(cy0 < 0)
+		cy0 = 0;
+	if(cx1 >= fb_width)
+		cx1 = fb_width - 1;
+	if(cy1 >= fb_height)
+		cy1 = fb_height - 1;
+
+	if((cx0 > cx1) || (cy0 > cy1))
+		return UVGA_OK;
+
+	wait_gfx_dma_end();
+
+	dirty_mark(cx0, cy0, cx1, cy1);
+
+	// rows after the last modified row are not decoded
+	for(j = 0; (y + j) <= cy1; j++)
+	{
+		// NULL row: decoded but not drawn
+		fb_row = ((y + j) >= cy0) ? frame_buffer + (y + j) * fb_row_stride : NULL;
+
+		i = 0;
+		while(i < w)
+		{
+			if((code = image_get(&s)) < 0)
+				return UVGA_INVALID_IMAGE;
+
+			if(code < 0x80)
+			{
+				// literal pixels, drawn by blocks of available bytes
+				n = code + 1;
+				if((i + n) > w)
+					return UVGA_INVALID_IMAGE;
+
+				while(n > 0)
+				{
+					if((k = image_available(&s, n)) == 0)
+						return UVGA_INVALID_IMAGE;
+
+					image_span(fb_row, y + j, x + i, k, s.ptr, 0, cx0, cx1);
+					s.ptr += k;
+					i += k;
+					n -= k;
+				}
+				continue;
+			}
+
+			if(code < 0xC0)
+				n = (code & 0x3F) + UVGA_IMAGE_SHORT_RUN_MIN;
+			else
+			{
+				if((k = image_get(&s)) < 0)
+					return UVGA_INVALID_IMAGE;
+
+				n = (((code & 0x3F) << 8) | k) + 1;
+			}
+
+			if(((color = image_get(&s)) < 0) || ((i + n) > w))
+				return UVGA_INVALID_IMAGE;
+
+			image_span(fb_row, y + j, x + i, n, NULL, color, cx0, cx1);
+			i += n;
+		}
+	}
+
+	return UVGA_OK;
+}
@@ -0,0 +1,272 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Streaming image import
+
+// RGB888 or RGB565 rows (from a file, a camera, USB...) are converted to RGB332 and written directly in frame buffer rows,
+// there is no intermediate image buffer. Each component is quantized with a table giving its RGB332 bits.
+// Tables accept values from -64 to 319: the ordered dither bias is added without clamping.
+
+// ordered dither: a bias depending on the position in a 4x4 Bayer matrix is added to each component before quantization.
+// error diffusion (Floyd-Steinberg): the quantization error of each pixel is spread on its right and lower neighbours.
+// Errors are stored in 1/16 units in 2 rows (current and next), the only memory allocated by an import.
+
+#define IMPORT_LUT_OFFSET		64
+
+static uint8_t import_quant_r[256 + 2 * IMPORT_LUT_OFFSET];
+static uint8_t import_quant_g[256 + 2 * IMPORT_LUT_OFFSET];
+static uint8_t import_quant_b[256 + 2 * IMPORT_LUT_OFFSET];
+static int8_t import_bayer_rg[16];		// bias of 3 bits components (red, green)
+static int8_t import_bayer_b[16];		// bias of 2 bits component (blue)
+static bool import_tables_ready = false;
+
+static const uint8_t import_bayer[16] = {
+															 0,  8,  2, 10,
+															12,  4, 14,  6,
+															 3, 11,  1,  9,
+															15,  7, 13,  5
+														};
+
+// 8 bits value of each quantized level
+static const uint8_t import_level3[8] = { 0, 36, 73, 109, 146, 182, 219, 255 };
+static const uint8_t import_level2[4] = { 0, 85, 170, 255 };
+
+// ============================================================================
+static void import_init_tables()
+{
+	int i;
+	int v;
+
+	if(import_tables_ready)
+		return;
+
+	for(i = 0; i < (256 + 2 * IMPORT_LUT_OFFSET); i++)
+	{
+		v = i - IMPORT_LUT_OFFSET;
+		if(v < 0)
+			v = 0;
+		else if(v > 255)
+			v = 255;
+
+		import_quant_r[i] = ((v * 7 + 127) / 255) << 5;
+		import_quant_g[i] = ((v * 7 + 127) / 255) << 2;
+		import_quant_b[i] = (v * 3 + 127) / 255;
+	}
+
+	// bias is between -1/2 and +1/2 quantization step
+	for(i = 0; i < 16; i++)
+	{
+		import_bayer_rg[i] = ((2 * import_bayer[i] + 1 - 16) * 255) / (32 * 7);
+		import_bayer_b[i] = ((2 * import_bayer[i] + 1 - 16) * 255) / (32 * 3);
+	}
+
+	import_tables_ready = true;
+}
+
+// read pixel i of a RGB888 or RGB565 row, components are expanded to 8 bits
+static inline void import_fetch(const uint8_t *rgb888, const uint16_t *rgb565, int i, int *r, int *g, int *b)
+{
+	uint16_t p;
+
+	if(rgb888 != NULL)
+	{
+		rgb888 += i * 3;
+		*r = rgb888[0];
+		*g = rgb888[1];
+		*b = rgb888[2];
+	}
+	else
+	{
+		p = rgb565[i];
+		*r = ((p >> 8) & 0xF8) | (p >> 13);
+		*g = ((p >> 3) & 0xFC) | ((p >> 9) & 3);
+		*b = ((p << 3) & 0xF8) | ((p >> 2) & 7);
+	}
+}
+
+// ============================================================================
+// start an import of rows of width pixels, the first row goes to frame buffer row y. Pixels outside of frame buffer are skipped
+uvga_error_t uVGA::beginImport(int x, int y, int width, uvga_dither dither)
+{
+	int nb;
+
+	endImport();
+
+	if(width <= 0)
+		return UVGA_OK;
+
+	import_init_tables();
+
+	if(dither == UVGA_DITHER_DIFFUSION)
+	{
+		nb = 2 * (width + 2) * 3;
+		import_err = (int16_t *) malloc(sizeof(int16_t) * nb);
+		if(import_err == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_IMPORT_BUFFER;
+
+		memset(import_err, 0, sizeof(int16_t) * nb);
+	}
+
+	import_x = x;
+	import_y = y;
+	import_w = width;
+	import_dither = dither;
+
+	return UVGA_OK;
+}
+
+void uVGA::endImport()
+{
+	if(import_err != NULL)
+	{
+		free(import_err);
+		import_err = NULL;
+	}
+
+	import_w = 0;
+}
+
+void uVGA::importRowRGB888(const uint8_t *rgb)
+{
+	import_row(rgb, NULL);
+}
+
+void uVGA::importRowRGB565(const uint16_t *rgb)
+{
+	import_row(NULL, rgb);
+}
+
+// ============================================================================
+// convert a row (rgb888 or rgb565 is NULL) and write it in the next frame buffer row
+void uVGA::import_row(const uint8_t *rgb888, const uint16_t *rgb565)
+{
+	int i, i0, i1;
+	int r, g, b;
+	int y;
+	int k;
+	uint8_t q;
+	uint8_t *dst;
+	const int8_t *bias_rg;
+	const int8_t *bias_b;
+	int16_t *cur;
+	int16_t *next;
+	int16_t *e;
+	int er, eg, eb;
+
+	if(import_w <= 0)
+		return;
+
+	y = import_y++;
+
+	// palette modes are not supported, rows outside of frame buffer are skipped
+	if((fb_bpp != 8) || (y < 0) || (y >= fb_height))
+		return;
+
+	// visible pixels
+	i0 = (import_x < 0) ? -import_x : 0;
+	i1 = import_w;
+	if((import_x + i1) > fb_width)
+		i1 = fb_width - import_x;
+
+	if(i0 >= i1)
+		return;
+
+	wait_gfx_dma_end();
+
+	dirty_mark(import_x + i0, y, import_x + i1 - 1, y);
+
+	dst = frame_buffer + y * fb_row_stride + import_x;
+
+	switch(import_dither)
+	{
+		case UVGA_DITHER_ORDERED:
+										// the matrix is aligned on frame buffer pixels, adjacent imports do not show seams
+										bias_rg = import_bayer_rg + ((y & 3) << 2);
+										bias_b = import_bayer_b + ((y & 3) << 2);
+
+										for(i = i0; i < i1; i++)
+										{
+											import_fetch(rgb888, rgb565, i, &r, &g, &b);
+											k = (import_x + i) & 3;
+
+											dst[i] = import_quant_r[r + IMPORT_LUT_OFFSET + bias_rg[k]]
+														| import_quant_g[g + IMPORT_LUT_OFFSET + bias_rg[k]]
+														| import_quant_b[b + IMPORT_LUT_OFFSET + bias_b[k]];
+										}
+										break;
+
+		case UVGA_DITHER_DIFFUSION:
+										// error rows are swapped on each frame buffer row. Pixel i uses entry i + 1, there is an entry on each side
+										cur = import_err + (y & 1) * (import_w + 2) * 3;
+										next = import_err + ((y + 1) & 1) * (import_w + 2) * 3;
+										memset(next, 0, sizeof(int16_t) * (import_w + 2) * 3);
+
+										for(i = i0; i < i1; i++)
+										{
+											import_fetch(rgb888, rgb565, i, &r, &g, &b);
+
+											e = cur + (i + 1) * 3;
+											r += (e[0] + 8) >> 4;
+											g += (e[1] + 8) >> 4;
+											b += (e[2] + 8) >> 4;
+
+											if(r < 0) r = 0; else if(r > 255) r = 255;
+											if(g < 0) g = 0; else if(g > 255) g = 255;
+											if(b < 0) b = 0; else if(b > 255) b = 255;
+
+											q = import_quant_r[r + IMPORT_LUT_OFFSET] | import_quant_g[g + IMPORT_LUT_OFFSET] | import_quant_b[b + IMPORT_LUT_OFFSET];
+											dst[i] = q;
+
+											er = r - import_level3[q >> 5];
+											eg = g - import_level3[(q >> 2) & 7];
+											eb = b - import_level2[q & 3];
+
+											// 7/16 right
+											e[3] += er * 7;
+											e[4] += eg * 7;
+											e[5] += eb * 7;
+
+											// 3/16 lower left, 5/16 below, 1/16 lower right
+											e = next + i * 3;
+											e[0] += er * 3;
+											e[1] += eg * 3;
+											e[2] += eb * 3;
+											e[3] += er * 5;
+											e[4] += eg * 5;
+											e[5] += eb * 5;
+											e[6] += er;
+											e[7] += eg;
+											e[8] += eb;
+										}
+										break;
+
+		default:
+										for(i = i0; i < i1; i++)
+										{
+											import_fetch(rgb888, rgb565, i, &r, &g, &b);
+
+											dst[i] = import_quant_r[r + IMPORT_LUT_OFFSET] | import_quant_g[g + IMPORT_LUT_OFFSET] | import_quant_b[b + IMPORT_LUT_OFFSET];
+										}
+										break;
+	}
+}
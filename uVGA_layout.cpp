@@ -0,0 +1,576 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Screen layout: which part of the frame buffer is displayed on each line
+
+// Line offsets
+// Each display line has its own TCD (or its own line buffer refill). Changing the source address of a line
+// moves it horizontally without moving a single byte of the frame buffer.
+// With UVGA_DMA_SINGLE, the TCD source address is patched. With UVGA_DMA_LINE_BUFFER, the offset is read when the line buffer is filled.
+
+// Virtual canvas
+// The frame buffer is larger than the displayed area. The viewport selects the first displayed row (row pointers) and the first
+// displayed pixel of each row (TCD source address, like line offsets).
+// When the canvas does not fit in SRAM_L (UVGA_DMA_AUTO only), each displayed row is copied by the 2nd DMA channel in one of the SRAM_L slots.
+// Copies are made by blocks of 16 bytes, so the horizontal position of the viewport is rounded down to a multiple of 16.
+
+// Split screen bands
+// Display lines are split in horizontal bands, each one has its own buffer, width, repeat_line factor and scrolling position.
+// Like line offsets, each display line has its own TCD (or its own line buffer refill) pointing in the buffer of its band.
+// Vertical scrolling wraps around band rows: a scrolling log only draws its new row and changes its scrolling position.
+
+// Vertical zoom
+// Each display line has its own TCD (or its own line buffer refill). Changing the frame buffer row of each line zooms without
+// drawing anything. In line buffer mode, groups of lines showing the same row change, line buffers are reassigned to TCD.
+
+// ============================================================================
+// allocate line offsets
+uvga_error_t uVGA::line_offsets_init()
+{
+	line_offsets = (int16_t *) malloc(sizeof(int16_t) * vp_rows);
+	if(line_offsets == NULL)
+		return UVGA_FAIL_TO_ALLOCATE_ROW_POINTER_ARRAY;
+
+	memset(line_offsets, 0, sizeof(int16_t) * vp_rows);
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+// allocate virtual canvas (RGB332 only, line buffer mode uses line_buffer_init())
+// memory layout: [SRAM_L slots][canvas rows]
+uvga_error_t uVGA::canvas_init()
+{
+	int slots_size;
+
+	canvas_slack = ((img_w + 15) & ~0xF) - img_w;
+	staging_copy_size = img_w + canvas_slack;
+	staging_slot_stride = staging_copy_size + 16;
+
+	fb_row_stride = UVGA_CANVAS_ROW_STRIDE(fb_width);
+	sram_l_nb_rows = staging_nb_buffers;
+	slots_size = staging_slot_stride * sram_l_nb_rows;
+
+	if(all_allocated_rows == NULL)
+	{
+		// same as UVGA_STAGED_CANVAS_SIZE()
+		all_allocated_rows = (uint8_t*) malloc(slots_size + fb_row_stride * fb_height + 15);
+
+		if(all_allocated_rows == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_FRAME_BUFFER;
+	}
+
+	all_allocated_rows_aligned = UVGA_BUFFER_START(all_allocated_rows);
+
+	sram_l_dma_address = all_allocated_rows_aligned;
+
+	// the first pixel of each row is canvas_slack bytes after a 16 bytes boundary
+	frame_buffer = all_allocated_rows_aligned + slots_size + canvas_slack;
+
+	memset(all_allocated_rows_aligned, 0, slots_size + fb_row_stride * fb_height);
+
+	img_h_no_margin = img_h - v_top_margin - v_bottom_margin;
+
+	fb_row_pointer = (uint8_t **) malloc(sizeof(uint8_t *) * img_h_no_margin);
+	if(fb_row_pointer == NULL)
+		return UVGA_FAIL_TO_ALLOCATE_ROW_POINTER_ARRAY;
+
+	layout_compute_row_pointers();
+
+	switch(dma_config_choice)
+	{
+		case UVGA_DMA_AUTO:
+						// any row of the canvas can be displayed
+						sram_u_dma_required = ((int)(all_allocated_rows_aligned + slots_size + fb_row_stride * fb_height - 1) >= SRAM_U_START_ADDRESS);
+						break;
+		default:
+						sram_u_dma_required = false;
+						break;
+	}
+
+	if(sram_u_dma_required)
+	{
+		// both slots must be in SRAM_L
+		if((((int)sram_l_dma_address) + slots_size - 1) >= SRAM_U_START_ADDRESS)
+			return UVGA_FAIL_TO_ALLOCATE_SRAM_L_BUFFER_IN_SRAM_L;
+	}
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+// allocate band buffers (RGB332 only) and line buffer ring if required
+uvga_error_t uVGA::bands_init()
+{
+	int b;
+	int first;
+	int min_height;
+	uvga_band_t *band;
+
+	if(fb_bpp != 8)
+		return UVGA_INVALID_BAND_LAYOUT;
+
+	img_h_no_margin = img_h - v_top_margin - v_bottom_margin;
+
+	first = 0;
+	for(b = 0; b < nb_bands; b++)
+	{
+		band = &bands[b];
+
+		// only the last band can use all remaining lines
+		if(band->nb_lines == 0)
+		{
+			if(b != (nb_bands - 1))
+				return UVGA_INVALID_BAND_LAYOUT;
+
+			band->nb_lines = img_h_no_margin - first;
+		}
+
+		band->first_line = first;
+		first += band->nb_lines;
+
+		if((band->nb_lines <= 0) || (first > img_h_no_margin))
+			return UVGA_INVALID_BAND_LAYOUT;
+
+		if(band->width < img_w)
+			band->width = img_w;
+
+		min_height = (band->nb_lines + band->repeat_line - 1) / band->repeat_line;
+		if(band->height < min_height)
+			band->height = min_height;
+
+		band->stride = UVGA_FB_ROW_STRIDE(band->width);
+
+		if(band->buffer == NULL)
+		{
+			band->buffer = (uint8_t*) malloc(UVGA_BAND_SIZE(band->width, band->height));
+			if(band->buffer == NULL)
+				return UVGA_FAIL_TO_ALLOCATE_FRAME_BUFFER;
+
+			memset(band->buffer, 0, UVGA_BAND_SIZE(band->width, band->height));
+		}
+
+		// the pixel DMA can only read SRAM_L buffers directly
+		if((dma_config_choice == UVGA_DMA_SINGLE) && (((int)(band->buffer + UVGA_BAND_SIZE(band->width, band->height) - 1)) >= SRAM_U_START_ADDRESS))
+			return UVGA_FRAME_BUFFER_FIRST_LINE_NOT_IN_SRAM_L;
+
+		if((dma_config_choice == UVGA_DMA_AUTO) && (((int)(band->buffer + UVGA_BAND_SIZE(band->width, band->height) - 1)) >= SRAM_U_START_ADDRESS))
+			dma_config_choice = UVGA_DMA_LINE_BUFFER;
+	}
+
+	if(first != img_h_no_margin)
+		return UVGA_INVALID_BAND_LAYOUT;
+
+	if(dma_config_choice == UVGA_DMA_AUTO)
+		dma_config_choice = UVGA_DMA_SINGLE;
+
+	fb_row_pointer = (uint8_t **) malloc(sizeof(uint8_t *) * img_h_no_margin);
+	if(fb_row_pointer == NULL)
+		return UVGA_FAIL_TO_ALLOCATE_ROW_POINTER_ARRAY;
+
+	layout_compute_row_pointers();
+
+	sram_u_dma_required = false;
+
+	// drawing functions use the first band
+	frame_buffer = bands[0].buffer;
+	fb_width = bands[0].width;
+	fb_height = bands[0].height;
+	fb_row_stride = bands[0].stride;
+
+	if(dma_config_choice != UVGA_DMA_LINE_BUFFER)
+	{
+		sram_l_nb_rows = 0;
+		return UVGA_OK;
+	}
+
+	// line buffer ring is the only part of the frame buffer
+	sram_l_nb_rows = lb_nb_line_buffers;
+	lb_row_stride = UVGA_FB_ROW_STRIDE(img_w);
+
+	if(all_allocated_rows == NULL)
+	{
+		all_allocated_rows = (uint8_t*) malloc(UVGA_LB_SIZE(img_w, lb_nb_line_buffers));
+		if(all_allocated_rows == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_FRAME_BUFFER;
+	}
+
+	all_allocated_rows_aligned = UVGA_BUFFER_START(all_allocated_rows);
+	sram_l_dma_address = all_allocated_rows_aligned;
+
+	if((((int)sram_l_dma_address) + lb_nb_line_buffers * lb_row_stride - 1) >= SRAM_U_START_ADDRESS)
+		return UVGA_FAIL_TO_ALLOCATE_SRAM_L_BUFFER_IN_SRAM_L;
+
+	memset(all_allocated_rows_aligned, 0, lb_row_stride * lb_nb_line_buffers);
+
+	return line_buffer_build_groups();
+}
+
+// ============================================================================
+// band of display line t
+int uVGA::layout_line_band(int t)
+{
+	int b;
+
+	for(b = 0; b < (nb_bands - 1); b++)
+	{
+		if(t < (bands[b].first_line + bands[b].nb_lines))
+			break;
+	}
+
+	return b;
+}
+
+// ============================================================================
+// compute frame buffer row of each display line from viewport position or band scrolling
+void uVGA::layout_compute_row_pointers()
+{
+	int t;
+	uvga_band_t *band;
+
+	for(t = 0; t < img_h_no_margin; t++)
+	{
+		if(nb_bands > 0)
+		{
+			band = &bands[layout_line_band(t)];
+			fb_row_pointer[t] = band->buffer + ((band->scroll_y + (t - band->first_line) / band->repeat_line) % band->height) * band->stride;
+		}
+		else if(frame_buffer != NULL)
+			fb_row_pointer[t] = frame_buffer + layout_line_row(t) * fb_row_stride;
+		else
+			fb_row_pointer[t] = NULL;
+	}
+}
+
+// ============================================================================
+// update TCD of display lines t to last - 1
+void uVGA::layout_patch_lines(int t, int last)
+{
+	// line buffers read offsets directly
+	if(dma_config_choice == UVGA_DMA_LINE_BUFFER)
+		return;
+
+	// SADDR is a 32 bits value, the DMA sees either the old or the new value
+	for(; t < last; t++)
+		px_dma_major_loop[t].SADDR = fb_row_pointer[t] + layout_line_x(t);
+}
+
+// ============================================================================
+// update TCD of all display lines of displayed row y
+void uVGA::layout_patch_row(int y)
+{
+	int t;
+	int last;
+
+	if(dma_config_choice == UVGA_DMA_LINE_BUFFER)
+		return;
+
+	// staged rows are only updated during vertical blanking by layout_patch_all()
+	if(sram_u_dma_required)
+		return;
+
+	t = y * complex_mode_ydiv;
+
+	last = t + complex_mode_ydiv;
+	if(last > img_h_no_margin)
+		last = img_h_no_margin;
+
+	layout_patch_lines(t, last);
+}
+
+// ============================================================================
+// update all display lines. Must be called during vertical blanking
+void uVGA::layout_patch_all()
+{
+	int g;
+
+	if(dma_config_choice == UVGA_DMA_LINE_BUFFER)
+	{
+		// the first line buffers were filled at the end of the previous frame
+		for(g = 0; (g < lb_nb_line_buffers) && (g < lb_nb_groups); g++)
+			line_buffer_render_group(g);
+
+		lb_next_group = g;
+		return;
+	}
+
+	if(!sram_u_dma_required)
+	{
+		layout_patch_lines(0, img_h_no_margin);
+		return;
+	}
+
+	staging_patch();
+
+	// the 2nd DMA channel has already loaded its first TCD and the first staged rows are already copied
+	sram_u_dma->SADDR = sram_u_dma_major_loop[0].SADDR;
+	staging_prefetch();
+}
+
+// ============================================================================
+// staged row copied by each TCD of the 2nd DMA channel
+// TCD e < N - K copies staged row e + K, the K last TCD copy the K first staged rows
+void uVGA::staging_patch()
+{
+	int e;
+	int s;
+	int t;
+	int nb_prefetch;
+
+	nb_prefetch = (staging_nb_rows < sram_l_nb_rows) ? staging_nb_rows : sram_l_nb_rows;
+
+	for(e = 0; e < staging_nb_rows; e++)
+	{
+		s = e + nb_prefetch;
+		if(s >= staging_nb_rows)
+			s -= staging_nb_rows;
+
+		t = staging_row_line[s];
+
+		// SADDR is 16 bytes aligned: canvas_slack bytes before the first displayed pixel
+		sram_u_dma_major_loop[e].SADDR = fb_row_pointer[t] + layout_line_x(t) - canvas_slack;
+		sram_u_dma_major_loop[e].DADDR = sram_l_dma_address + (s % sram_l_nb_rows) * staging_slot_stride;
+	}
+}
+
+// ============================================================================
+// copy the first staged rows in their slots using the CPU
+void uVGA::staging_prefetch()
+{
+	int s;
+	int t;
+
+	for(s = 0; (s < staging_nb_rows) && (s < sram_l_nb_rows); s++)
+	{
+		t = staging_row_line[s];
+		memcpy(sram_l_dma_address + s * staging_slot_stride, fb_row_pointer[t] + layout_line_x(t) - canvas_slack, staging_copy_size);
+	}
+}
+
+// ============================================================================
+// set horizontal offset of a displayed row
+void uVGA::setLineOffset(int y, int dx)
+{
+	if((line_offsets == NULL) || (y < 0) || (y >= vp_rows))
+		return;
+
+	if(dx < 0)
+		dx = 0;
+	else if(dx > (fb_width - img_w))
+		dx = fb_width - img_w;
+
+	// the TCDs of the row are patched during vertical blanking, the row is never displayed half moved
+	waitBeam();
+
+	line_offsets[y] = dx;
+	layout_patch_row(y);
+}
+
+// ============================================================================
+// set horizontal offset of all displayed rows
+void uVGA::setLineOffsets(const int16_t *offsets)
+{
+	int y;
+	int dx;
+
+	if(line_offsets == NULL)
+		return;
+
+	// update all rows during vertical blanking, all lines of the next frame use the new offsets
+	waitBeam();
+
+	for(y = 0; y < vp_rows; y++)
+	{
+		dx = offsets[y];
+
+		if(dx < 0)
+			dx = 0;
+		else if(dx > (fb_width - img_w))
+			dx = fb_width - img_w;
+
+		line_offsets[y] = dx;
+	}
+
+	layout_patch_all();
+}
+
+// ============================================================================
+int uVGA::getLineOffset(int y)
+{
+	if((line_offsets == NULL) || (y < 0) || (y >= vp_rows))
+		return 0;
+
+	return line_offsets[y];
+}
+
+// ============================================================================
+// move viewport of the virtual canvas
+void uVGA::setViewport(int x, int y)
+{
+	if(!canvas_enabled)
+		return;
+
+	if(x > (fb_width - img_w))
+		x = fb_width - img_w;
+	if(x < 0)
+		x = 0;
+
+	if(y > (fb_height - vp_rows))
+		y = fb_height - vp_rows;
+	if(y < 0)
+		y = 0;
+
+	// SRAM_U DMA copies blocks of 16 bytes
+	if((dma_config_choice != UVGA_DMA_LINE_BUFFER) && sram_u_dma_required)
+		x &= ~0xF;
+
+	waitBeam();
+
+	vp_x = x;
+	vp_y = y;
+
+	layout_compute_row_pointers();
+	layout_patch_all();
+}
+
+void uVGA::getViewport(int *x, int *y)
+{
+	*x = vp_x;
+	*y = vp_y;
+}
+
+// ============================================================================
+// select the band used by drawing functions
+void uVGA::selectBand(int band, uint8_t *buffer)
+{
+	if((band < 0) || (band >= nb_bands))
+		return;
+
+	frame_buffer = (buffer != NULL) ? buffer : bands[band].buffer;
+	fb_width = bands[band].width;
+	fb_height = bands[band].height;
+	fb_row_stride = bands[band].stride;
+
+	// print window is the whole band
+	cursor_x = 0;
+	cursor_y = 0;
+	print_window_x = 0;
+	print_window_y = 0;
+	print_window_w = fb_width / font_width;
+	print_window_h = fb_height / font_height;
+
+	if(text_cells != NULL)
+		enableTextMode();
+
+	// the dirty map covers the selected band only, it is recreated empty with the same cell size (disabled if it cannot be allocated)
+	if(dirty_map != NULL)
+		enableDirtyTracking(1 << dirty_cell_w_shift, 1 << dirty_cell_h_shift);
+}
+
+// ============================================================================
+// scroll a band
+void uVGA::setBandScroll(int band, int x, int y)
+{
+	if((band < 0) || (band >= nb_bands))
+		return;
+
+	if(x > (bands[band].width - img_w))
+		x = bands[band].width - img_w;
+	if(x < 0)
+		x = 0;
+
+	y %= bands[band].height;
+	if(y < 0)
+		y += bands[band].height;
+
+	waitBeam();
+
+	bands[band].scroll_x = x;
+	bands[band].scroll_y = y;
+
+	layout_compute_row_pointers();
+	layout_patch_all();
+}
+
+// ============================================================================
+// display another buffer in a band. The buffer must have the size of the band buffer
+void uVGA::setBandBuffer(int band, uint8_t *buffer)
+{
+	if((band < 0) || (band >= nb_bands) || (buffer == NULL))
+		return;
+
+	waitBeam();
+
+	bands[band].buffer = buffer;
+
+	layout_compute_row_pointers();
+	layout_patch_all();
+}
+
+uint8_t *uVGA::getBandBuffer(int band)
+{
+	if((band < 0) || (band >= nb_bands))
+		return NULL;
+
+	return bands[band].buffer;
+}
+
+// ============================================================================
+// change vertical zoom
+void uVGA::setVerticalZoom(int first_row, int scale)
+{
+	if((!zoom_enabled) || (nb_bands > 0))
+		return;
+
+	if(scale < 1)
+		scale = 1;
+	else if(scale > 0x7FFF)
+		scale = 0x7FFF;
+
+	if(first_row < 0)
+		first_row = 0;
+	else if(first_row >= fb_height)
+		first_row = fb_height - 1;
+
+	waitBeam();
+
+	zoom_first_row = first_row;
+	zoom_scale = scale;
+
+	layout_compute_row_pointers();
+
+	if(dma_config_choice == UVGA_DMA_LINE_BUFFER)
+	{
+		// groups of lines depend on zoom
+		line_buffer_build_groups();
+		line_buffer_patch_tcds();
+	}
+
+	layout_patch_all();
+}
+
+void uVGA::getVerticalZoom(int *first_row, int *scale)
+{
+	*first_row = zoom_first_row;
+	*scale = zoom_scale;
+}
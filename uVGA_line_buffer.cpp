@@ -0,0 +1,235 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Line buffer mode (UVGA_DMA_LINE_BUFFER)
+
+// Instead of reading the frame buffer, the pixel DMA channel reads a small ring of N line buffers located in SRAM_L.
+// Consecutive display lines showing the same frame buffer row (repeat_line > 1) form a group. Group g is displayed
+// from line buffer g % N. The TCD of the last display line of each group raises a DMA interrupt: at this time, the line buffer
+// of this group is free and the CPU fills it with the group displayed N groups later (just in time, "racing the beam").
+// The last image line also raises the interrupt, the CPU uses vertical blanking time to fill the N first groups of the next frame.
+
+// The content of the line is produced either by a user callback (no frame buffer at all, only N lines of RAM)
+// or by a copy of the frame buffer row (the frame buffer can be anywhere in RAM, only the ring must be in SRAM_L).
+
+// Each line buffer is lb_row_stride bytes but only img_w bytes (displayed width) are written. The remaining bytes are never modified
+// and stay black, they provide the black pixel required at the end of each line.
+
+uVGA *uVGA::lb_instance = NULL;
+
+// ============================================================================
+// allocate line buffer ring (and frame buffer if no callback is used)
+uvga_error_t uVGA::line_buffer_init()
+{
+	sram_l_nb_rows = lb_nb_line_buffers;
+
+	// line buffers are always RGB332, frame buffer rows may be packed (palette modes)
+	// frame buffer rows may be wider than the displayed width (line offsets, virtual canvas)
+	lb_row_stride = UVGA_FB_ROW_STRIDE(img_w);
+
+	if(all_allocated_rows == NULL)
+	{
+		// same as UVGA_LB_FB_SIZE() or UVGA_PAL_FB_SIZE()
+		if(scanline_callback == NULL)
+			all_allocated_rows = (uint8_t*) malloc(lb_row_stride * lb_nb_line_buffers + fb_row_stride * fb_height + 15);
+		else
+			all_allocated_rows = (uint8_t*) malloc(UVGA_LB_SIZE(img_w, lb_nb_line_buffers));
+
+		if(all_allocated_rows == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_FRAME_BUFFER;
+	}
+
+	all_allocated_rows_aligned = UVGA_BUFFER_START(all_allocated_rows);
+
+	// line buffer ring is at the beginning, the whole ring must be in SRAM_L
+	sram_l_dma_address = all_allocated_rows_aligned;
+
+	if((((int)sram_l_dma_address) + lb_nb_line_buffers * lb_row_stride - 1) >= SRAM_U_START_ADDRESS)
+		return UVGA_FAIL_TO_ALLOCATE_SRAM_L_BUFFER_IN_SRAM_L;
+
+	memset(all_allocated_rows_aligned, 0, lb_row_stride * lb_nb_line_buffers);
+
+	if(scanline_callback == NULL)
+	{
+		frame_buffer = all_allocated_rows_aligned + lb_nb_line_buffers * lb_row_stride;
+		memset(frame_buffer, 0, fb_row_stride * fb_height);
+	}
+	else
+		frame_buffer = NULL;
+
+	img_h_no_margin = img_h - v_top_margin - v_bottom_margin;
+
+	fb_row_pointer = (uint8_t **) malloc(sizeof(uint8_t *) * img_h_no_margin);
+	if(fb_row_pointer == NULL)
+		return UVGA_FAIL_TO_ALLOCATE_ROW_POINTER_ARRAY;
+
+	layout_compute_row_pointers();
+
+	// DMA never reads the frame buffer
+	sram_u_dma_required = false;
+
+	return line_buffer_build_groups();
+}
+
+// ============================================================================
+// split display lines into groups of consecutive lines showing the same frame buffer row
+uvga_error_t uVGA::line_buffer_build_groups()
+{
+	int t;
+	int g;
+
+	lb_nb_groups = 0;
+
+	for(t = 0; t < img_h_no_margin; t++)
+	{
+		if(layout_new_row(t))
+			lb_nb_groups++;
+	}
+
+	// allocated for the maximal number of groups, the groups may change with vertical zoom
+	if(lb_group_line == NULL)
+	{
+		lb_group_line = (short *) malloc(sizeof(short) * img_h_no_margin);
+		if(lb_group_line == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_ROW_POINTER_ARRAY;
+	}
+
+	g = -1;
+	for(t = 0; t < img_h_no_margin; t++)
+	{
+		if(layout_new_row(t))
+			lb_group_line[++g] = t;
+	}
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+// set line buffer and refill interrupt of each display line TCD from groups
+void uVGA::line_buffer_patch_tcds()
+{
+	int t;
+	int group;
+	DMABaseClass::TCD_t *cur_tcd;
+
+	group = 0;
+	for(t = 0; t < img_h_no_margin; t++)
+	{
+		if((t != 0) && layout_new_row(t))
+			group++;
+
+		cur_tcd = &px_dma_major_loop[t];
+
+		cur_tcd->SADDR = sram_l_dma_address + (group % lb_nb_line_buffers) * lb_row_stride;	// source is the line buffer of the group of line 't'
+
+		// on the last line of a group, the line buffer is no more used, the interrupt will refill it
+		if((t == (img_h_no_margin - 1)) || layout_new_row(t + 1))
+			cur_tcd->CSR |= DMA_TCD_CSR_INTMAJOR;
+		else
+			cur_tcd->CSR &= ~DMA_TCD_CSR_INTMAJOR;
+	}
+}
+
+// ============================================================================
+// fill the line buffer of a group
+void uVGA::line_buffer_render_group(int group)
+{
+	uint8_t *line_buffer;
+	uint8_t *src;
+	int t;
+	const uint8_t *lut;
+
+	line_buffer = sram_l_dma_address + (group % lb_nb_line_buffers) * lb_row_stride;
+	t = lb_group_line[group];
+
+	if(scanline_callback != NULL)
+	{
+		scanline_callback(line_buffer, layout_line_row(t), img_w);
+		return;
+	}
+
+	// horizontal position of the row (viewport, line offset or band scrolling). In palette modes, it is rounded to a whole number of packed bytes
+	src = fb_row_pointer[t] + ((layout_line_x(t) << fb_bpp_shift) >> 3);
+
+	if(fb_bpp != 8)
+		palette_expand_row(line_buffer, src);	// color lut is already merged in expansion table
+	else if((lut = color_lut) != NULL)
+		color_lut_copy_row(line_buffer, src, lut);
+	else
+		memcpy(line_buffer, src, img_w);
+}
+
+// ============================================================================
+// fill the first line buffers and enable the pixel DMA interrupt
+// must be called after TCD creation and before clocks start
+void uVGA::line_buffer_start()
+{
+	int g;
+
+	for(g = 0; (g < lb_nb_line_buffers) && (g < lb_nb_groups); g++)
+		line_buffer_render_group(g);
+
+	lb_next_group = g;
+
+	lb_instance = this;
+
+	// DMA channels n and n+16 share the same interrupt vector
+	attachInterruptVector((IRQ_NUMBER_t)(IRQ_DMA_CH0 + (dma_num & 0xF)), line_buffer_isr);
+
+	// nothing must delay the line production
+	NVIC_SET_PRIORITY(IRQ_DMA_CH0 + (dma_num & 0xF), 0);
+	NVIC_ENABLE_IRQ(IRQ_DMA_CH0 + (dma_num & 0xF));
+}
+
+// ============================================================================
+// pixel DMA interrupt. Called after the last display line of each group
+void uVGA::line_buffer_isr()
+{
+	uVGA *vga = lb_instance;
+	int line;
+	int g;
+
+	vga->edma->CINT = vga->dma_num;
+
+	// when the interrupt occurs, the next TCD is already loaded, its DLASTSGA points 2 TCDs after the line just displayed
+	line = ((int)(vga->px_dma->DLASTSGA) - (int)(vga->px_dma_major_loop)) / sizeof(DMABaseClass::TCD_t) - 2;
+
+	if(line >= (vga->img_h_no_margin - 1))
+	{
+		// end of image, all line buffers are free. Prepare the beginning of the next frame during vertical blanking
+		for(g = 0; (g < vga->lb_nb_line_buffers) && (g < vga->lb_nb_groups); g++)
+			vga->line_buffer_render_group(g);
+
+		vga->lb_next_group = g;
+	}
+	else
+	{
+		g = vga->lb_next_group;
+
+		if(g < vga->lb_nb_groups)
+		{
+			vga->line_buffer_render_group(g);
+			vga->lb_next_group = g + 1;
+		}
+	}
+}
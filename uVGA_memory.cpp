@@ -0,0 +1,159 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Memory plan
+// Describe where frame buffer rows are (SRAM_L or SRAM_U), which DMA configuration was chosen and how many bytes per second
+// the scanout reads in each SRAM bank. SRAM_L is on the CODE bus, SRAM_U on the system bus: the less the scanout reads in SRAM_U,
+// the more bandwidth the CPU has for its own SRAM_U data.
+
+// ============================================================================
+// true if the 'size' bytes at 'address' are entirely in SRAM_L
+static inline bool in_sram_l(const uint8_t *address, int size)
+{
+	return (((int)address) + size - 1) < SRAM_U_START_ADDRESS;
+}
+
+// ============================================================================
+void uVGA::get_memory_plan(uvga_memory_plan_t *plan)
+{
+	int r;
+	int t;
+	int g;
+	int nbytes;
+	int sram_l_bytes = 0;		// per frame
+	int sram_u_bytes = 0;
+	uvga_band_t *band;
+
+	memset(plan, 0, sizeof(uvga_memory_plan_t));
+	plan->first_row_in_sram_u = -1;
+
+	if(fb_row_pointer == NULL)
+		return;
+
+	// 1) rows
+	if(nb_bands > 0)
+	{
+		for(g = 0; g < nb_bands; g++)
+		{
+			band = &bands[g];
+			for(r = 0; r < band->height; r++)
+			{
+				if(in_sram_l(band->buffer + r * band->stride, band->stride))
+					plan->rows_in_sram_l++;
+				else if(plan->first_row_in_sram_u < 0)
+					plan->first_row_in_sram_u = plan->nb_rows + r;
+			}
+
+			plan->nb_rows += band->height;
+			plan->frame_buffer_bytes += UVGA_BAND_SIZE(band->width, band->height);
+		}
+	}
+	else if(frame_buffer != NULL)
+	{
+		plan->nb_rows = fb_height;
+		for(r = 0; r < fb_height; r++)
+		{
+			if(in_sram_l(frame_buffer + r * fb_row_stride, fb_row_stride))
+				plan->rows_in_sram_l++;
+			else if(plan->first_row_in_sram_u < 0)
+				plan->first_row_in_sram_u = r;
+		}
+
+		plan->frame_buffer_bytes = fb_row_stride * fb_height;
+	}
+
+	plan->rows_in_sram_u = plan->nb_rows - plan->rows_in_sram_l;
+
+	// 2) DMA resources and bytes read per frame
+	plan->nb_dma_channels = 1;
+	plan->tcd_bytes = (px_dma_nb_major_loop + sram_u_dma_nb_major_loop) * sizeof(DMABaseClass::TCD_t);
+
+	if(dma_config_choice == UVGA_DMA_LINE_BUFFER)
+	{
+		plan->dma_mode = UVGA_DMA_LINE_BUFFER;
+		plan->nb_sram_l_buffers = lb_nb_line_buffers;
+		plan->frame_buffer_bytes += lb_row_stride * lb_nb_line_buffers;
+
+		// the pixel DMA reads line buffers, the CPU reads each frame buffer row once
+		sram_l_bytes = img_h_no_margin * lb_row_stride;
+
+		for(g = 0; (g < lb_nb_groups) && (frame_buffer != NULL || nb_bands > 0); g++)
+		{
+			t = lb_group_line[g];
+			nbytes = (img_w * fb_bpp + 7) >> 3;
+
+			if(in_sram_l(fb_row_pointer[t], nbytes))
+				sram_l_bytes += nbytes;
+			else
+				sram_u_bytes += nbytes;
+		}
+	}
+	else if(sram_u_dma_required)
+	{
+		plan->dma_mode = UVGA_DMA_AUTO;
+		plan->nb_dma_channels = 2;
+		plan->nb_sram_l_buffers = sram_l_nb_rows;
+		plan->frame_buffer_bytes += staging_slot_stride * sram_l_nb_rows;
+
+		for(t = 0; t < img_h_no_margin; t++)
+		{
+			if(staging_line_is_staged(t))
+				sram_l_bytes += img_w + 1;
+			else
+				sram_l_bytes += fb_row_stride;
+		}
+
+		// each staged row is copied once per frame
+		for(g = 0; g < staging_nb_rows; g++)
+		{
+			t = staging_row_line[g];
+
+			if(in_sram_l(fb_row_pointer[t] + layout_line_x(t) - canvas_slack, staging_copy_size))
+				sram_l_bytes += staging_copy_size;
+			else
+				sram_u_bytes += staging_copy_size;
+		}
+	}
+	else
+	{
+		plan->dma_mode = UVGA_DMA_SINGLE;
+		plan->nb_sram_l_buffers = 0;
+
+		// the 3rd DMA channel sends the black pixel when only a part of rows is displayed
+		if(dma_partial_rows)
+			plan->nb_dma_channels = 2;
+
+		nbytes = dma_partial_rows ? img_w : fb_row_stride;
+
+		for(t = 0; t < img_h_no_margin; t++)
+		{
+			if(in_sram_l(fb_row_pointer[t] + (dma_partial_rows ? layout_line_x(t) : 0), nbytes))
+				sram_l_bytes += nbytes;
+			else
+				sram_u_bytes += nbytes;
+		}
+	}
+
+	plan->sram_l_bytes_per_second = sram_l_bytes * img_frame_rate;
+	plan->sram_u_bytes_per_second = sram_u_bytes * img_frame_rate;
+}
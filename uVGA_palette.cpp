@@ -0,0 +1,269 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Palette modes (UVGA_PAL1, UVGA_PAL2, UVGA_PAL4)
+
+// Frame buffer rows contain packed palette index (first pixel in the most significant bits of the first byte).
+// Each row is expanded in a RGB332 line buffer just before being displayed. To be fast enough, expansion uses a table
+// converting 1 packed byte into 8 (1bpp), 4 (2bpp) or 2 (4bpp) RGB332 pixels and writes the line buffer 32 bits at a time.
+
+// Palette changes are done during scanout (palette animation). The table is rebuilt in a 2nd table which then replaces the
+// displayed one with a single pointer write. The line buffer interrupt reads the pointer once per row, a row is never
+// expanded with a partially rebuilt table.
+
+// default palettes
+static const uint8_t default_palette_2[2] = { 0x00, 0xFF };								// black, white
+static const uint8_t default_palette_4[4] = { 0x00, 0x49, 0xB6, 0xFF };				// black, dark grey, light grey, white
+static const uint8_t default_palette_16[16] = {													// CGA like palette
+															0x00, 0x02, 0x10, 0x12, 0x80, 0x82, 0x88, 0xB6,
+															0x49, 0x4B, 0x5D, 0x5F, 0xE9, 0xEB, 0xFC, 0xFF
+														};
+
+// ============================================================================
+// load default palette (if none was set) and allocate expansion table
+uvga_error_t uVGA::palette_init()
+{
+	int nb_words;
+
+	if(!palette_user_defined)
+	{
+		switch(fb_bpp)
+		{
+			case 1:
+						memcpy(palette, default_palette_2, sizeof(default_palette_2));
+						break;
+			case 2:
+						memcpy(palette, default_palette_4, sizeof(default_palette_4));
+						break;
+			default:
+						memcpy(palette, default_palette_16, sizeof(default_palette_16));
+						break;
+		}
+	}
+
+	// 1bpp: 256 entries of 8 pixels, 2bpp: 256 entries of 4 pixels, 4bpp: 256 entries of 2 pixels
+	switch(fb_bpp)
+	{
+		case 1:
+					nb_words = 256 * 2;
+					break;
+		case 2:
+					nb_words = 256;
+					break;
+		default:
+					nb_words = 256 / 2;
+					break;
+	}
+
+	// displayed table and table being rebuilt
+	if(palette_lut == NULL)
+	{
+		palette_lut_back = (uint32_t *) malloc(sizeof(uint32_t) * nb_words * 2);
+		if(palette_lut_back == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_PALETTE_LUT;
+
+		palette_lut = palette_lut_back + nb_words;
+	}
+
+	palette_build_lut();
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+// compute expansion table from palette in the 2nd table, then display it
+void uVGA::palette_build_lut()
+{
+	int b;
+	int i;
+	uint8_t *pixels;
+	uint8_t colors[16];
+	const uint8_t *lut = color_lut;
+	uint32_t *table = palette_lut_back;
+
+	if(table == NULL)
+		return;
+
+	// scanout color lut is applied on palette
+	for(i = 0; i < 16; i++)
+		colors[i] = (lut != NULL) ? lut[palette[i]] : palette[i];
+
+	for(b = 0; b < 256; b++)
+	{
+		// pixels are stored in increasing address order, whatever the endianness
+		switch(fb_bpp)
+		{
+			case 1:
+						pixels = (uint8_t *)&table[b * 2];
+						for(i = 0; i < 8; i++)
+							pixels[i] = colors[(b >> (7 - i)) & 1];
+						break;
+			case 2:
+						pixels = (uint8_t *)&table[b];
+						for(i = 0; i < 4; i++)
+							pixels[i] = colors[(b >> (6 - i * 2)) & 3];
+						break;
+			default:
+						pixels = ((uint8_t *)table) + b * 2;
+						pixels[0] = colors[b >> 4];
+						pixels[1] = colors[b & 0xF];
+						break;
+		}
+	}
+
+	// the line buffer interrupt cannot be in the middle of a row here (it is not interrupted by this code),
+	// rows expanded after this point use the new table
+	palette_lut_back = palette_lut;
+	palette_lut = table;
+}
+
+// ============================================================================
+// convert a packed frame buffer row into a RGB332 line buffer
+// line buffer must be 4 bytes aligned
+void uVGA::palette_expand_row(uint8_t *line_buffer, const uint8_t *row)
+{
+	uint32_t *dst = (uint32_t *)line_buffer;
+	int nb_bytes = (img_w * fb_bpp + 7) >> 3;		// number of packed bytes of the displayed part of the row
+	const uint32_t *table = palette_lut;		// read once, the table may be swapped after this row
+	const uint32_t *lut;
+	const uint16_t *lut16;
+
+	switch(fb_bpp)
+	{
+		case 1:
+					while(nb_bytes--)
+					{
+						lut = &table[(*row++) << 1];
+						*dst++ = lut[0];
+						*dst++ = lut[1];
+					}
+					break;
+
+		case 2:
+					lut = table;
+					while(nb_bytes--)
+						*dst++ = lut[*row++];
+					break;
+
+		default:
+					lut16 = (const uint16_t *)table;
+					while(nb_bytes >= 2)
+					{
+						*dst++ = lut16[row[0]] | (lut16[row[1]] << 16);
+						row += 2;
+						nb_bytes -= 2;
+					}
+
+					if(nb_bytes)
+						*dst++ = lut16[row[0]];
+					break;
+	}
+
+	// the last packed byte may contain unused pixels, pixels after the end of the line must stay black
+	memset(line_buffer + img_w, 0, ((uint8_t *)dst) - (line_buffer + img_w));
+}
+
+// ============================================================================
+// palette modification
+// ============================================================================
+void uVGA::setPalette(const uint8_t *new_palette, int nb_colors)
+{
+	if(nb_colors > 16)
+		nb_colors = 16;
+
+	if(nb_colors <= 0)
+		return;
+
+	memcpy(palette, new_palette, nb_colors);
+	palette_user_defined = true;
+
+	palette_build_lut();
+}
+
+void uVGA::setPaletteColor(int index, uint8_t color)
+{
+	if((index < 0) || (index >= 16))
+		return;
+
+	palette[index] = color;
+	palette_user_defined = true;
+
+	palette_build_lut();
+}
+
+uint8_t uVGA::getPaletteColor(int index)
+{
+	if((index < 0) || (index >= 16))
+		return 0;
+
+	return palette[index];
+}
+
+// ============================================================================
+// scanout color lookup table
+// ============================================================================
+void uVGA::setColorLut(const uint8_t *lut)
+{
+	color_lut = lut;
+
+	// in palette modes, the lut is merged in the expansion table
+	palette_build_lut();
+}
+
+void uVGA::makeBrightnessLut(uint8_t *lut, int brightness)
+{
+	int c;
+
+	if(brightness < 0)
+		brightness = 0;
+	else if(brightness > 256)
+		brightness = 256;
+
+	for(c = 0; c < 256; c++)
+	{
+		lut[c] = ((((c >> 5) & 7) * brightness >> 8) << 5)
+				 | ((((c >> 2) & 7) * brightness >> 8) << 2)
+				 | (((c & 3) * brightness) >> 8);
+	}
+}
+
+// ============================================================================
+// copy a RGB332 frame buffer row into a line buffer through a color lookup table
+// line buffer must be 4 bytes aligned
+void uVGA::color_lut_copy_row(uint8_t *line_buffer, const uint8_t *row, const uint8_t *lut)
+{
+	uint32_t *dst = (uint32_t *)line_buffer;
+	int nb = img_w;
+
+	// 4 pixels per write
+	while(nb >= 4)
+	{
+		*dst++ = lut[row[0]] | (lut[row[1]] << 8) | (lut[row[2]] << 16) | (lut[row[3]] << 24);
+		row += 4;
+		nb -= 4;
+	}
+
+	line_buffer = (uint8_t *)dst;
+	while(nb--)
+		*line_buffer++ = lut[*row++];
+}
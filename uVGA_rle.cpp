@@ -0,0 +1,83 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA_rle.h"
+
+// RLE sprite encoder, see uVGA_rle.h for the format. Only depends on stdint.h
+
+// ============================================================================
+// write a byte if there is enough room
+static inline void rle_put(uint8_t *rle, int rle_size, int pos, uint8_t value)
+{
+	if((rle != NULL) && (pos < rle_size))
+		rle[pos] = value;
+}
+
+// ============================================================================
+int uvga_rle_encode(const uint8_t *bitmap, int width, int height, uint8_t key_color, uint8_t *rle, int rle_size)
+{
+	int x, y;
+	int pos;
+	int skip;
+	int opaque;
+	const uint8_t *row;
+
+	if((width <= 0) || (height <= 0) || (width > 65535) || (height > 65535))
+		return -1;
+
+	rle_put(rle, rle_size, 0, width);
+	rle_put(rle, rle_size, 1, width >> 8);
+	rle_put(rle, rle_size, 2, height);
+	rle_put(rle, rle_size, 3, height >> 8);
+
+	pos = UVGA_RLE_HEADER_SIZE(height);
+
+	for(y = 0; y < height; y++)
+	{
+		row = bitmap + y * width;
+
+		rle_put(rle, rle_size, 4 + 4 * y, pos);
+		rle_put(rle, rle_size, 5 + 4 * y, pos >> 8);
+		rle_put(rle, rle_size, 6 + 4 * y, pos >> 16);
+		rle_put(rle, rle_size, 7 + 4 * y, pos >> 24);
+
+		x = 0;
+		while(x < width)
+		{
+			// transparent pixels, at most 255
+			for(skip = 0; (x < width) && (skip < 255) && (row[x] == key_color); skip++, x++);
+
+			// opaque pixels, at most 255
+			for(opaque = 0; ((x + opaque) < width) && (opaque < 255) && (row[x + opaque] != key_color); opaque++);
+
+			rle_put(rle, rle_size, pos++, skip);
+			rle_put(rle, rle_size, pos++, opaque);
+
+			for(; opaque > 0; opaque--)
+				rle_put(rle, rle_size, pos++, row[x++]);
+		}
+	}
+
+	if((rle != NULL) && (pos > rle_size))
+		return -1;
+
+	return pos;
+}
@@ -0,0 +1,62 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#ifndef _UVGA_RLE_H
+#define _UVGA_RLE_H
+
+// RLE sprite format. This file does not depend on Teensy and can be used to encode sprites on a computer
+
+// all values are little endian
+// offset 0: width (16 bits)
+// offset 2: height (16 bits)
+// offset 4: row offsets (32 bits, one per row) from the beginning of the sprite
+// rows: a sequence of runs. A run is a number of transparent pixels to skip (8 bits), a number of opaque pixels (8 bits)
+//       then the opaque pixels (1 byte per pixel). The row ends when the sum of run lengths reaches the width
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define UVGA_RLE_HEADER_SIZE(height)		(4 + 4 * (height))
+
+// encode a bitmap (1 byte per pixel), pixels having key_color are transparent
+// return the size of the encoded sprite. If rle is NULL, nothing is written (size computation only). Return -1 if rle_size is too small
+int uvga_rle_encode(const uint8_t *bitmap, int width, int height, uint8_t key_color, uint8_t *rle, int rle_size);
+
+// sprite size
+static inline int uvga_rle_width(const uint8_t *rle)
+{
+	return rle[0] | (rle[1] << 8);
+}
+
+static inline int uvga_rle_height(const uint8_t *rle)
+{
+	return rle[2] | (rle[3] << 8);
+}
+
+// first run of a row
+static inline const uint8_t *uvga_rle_row(const uint8_t *rle, int row)
+{
+	const uint8_t *p = rle + 4 + 4 * row;
+
+	return rle + (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+#endif
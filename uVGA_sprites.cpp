@@ -0,0 +1,291 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Sprite engine
+
+// Each sprite saves the frame buffer area it covers before being drawn. updateSprites() waits for vertical blanking,
+// restores the saved areas in reverse drawing order (the frame buffer is back to the scene without sprites), then saves
+// and draws all visible sprites by increasing z. Only the areas of the sprites are read and written.
+
+// ============================================================================
+// clip a rectangle to the frame buffer, return false if nothing is visible
+static inline bool sprite_clip(uvga_rect_t *r, int x, int y, int w, int h, int fb_w, int fb_h)
+{
+	r->x0 = (x < 0) ? 0 : x;
+	r->y0 = (y < 0) ? 0 : y;
+	r->x1 = ((x + w) > fb_w) ? fb_w - 1 : x + w - 1;
+	r->y1 = ((y + h) > fb_h) ? fb_h - 1 : y + h - 1;
+
+	return (r->x0 <= r->x1) && (r->y0 <= r->y1);
+}
+
+// ============================================================================
+// allocate nb_sprites sprites, all hidden. 0 frees the sprites
+uvga_error_t uVGA::initSprites(int nb_sprites)
+{
+	int i;
+
+	if(sprites != NULL)
+	{
+		eraseSprites();
+
+		for(i = 0; i < nb_sprites_allocated; i++)
+		{
+			if(sprites[i].save != NULL)
+				free(sprites[i].save);
+		}
+
+		free(sprites);
+		free(sprite_order);
+		free(sprite_dirty_rects);
+		sprites = NULL;
+		sprite_order = NULL;
+		sprite_dirty_rects = NULL;
+	}
+
+	nb_sprites_allocated = 0;
+	sprite_nb_dirty_rects = 0;
+
+	if(nb_sprites <= 0)
+		return UVGA_OK;
+
+	sprites = (uvga_sprite_t *) malloc(sizeof(uvga_sprite_t) * nb_sprites);
+	sprite_order = (short *) malloc(sizeof(short) * nb_sprites);
+	sprite_dirty_rects = (uvga_rect_t *) malloc(sizeof(uvga_rect_t) * nb_sprites * 2);	// old and new position of each sprite
+
+	if((sprites == NULL) || (sprite_order == NULL) || (sprite_dirty_rects == NULL))
+	{
+		if(sprites != NULL)
+			free(sprites);
+		if(sprite_order != NULL)
+			free(sprite_order);
+		if(sprite_dirty_rects != NULL)
+			free(sprite_dirty_rects);
+
+		sprites = NULL;
+		sprite_order = NULL;
+		sprite_dirty_rects = NULL;
+		return UVGA_FAIL_TO_ALLOCATE_SPRITES;
+	}
+
+	memset(sprites, 0, sizeof(uvga_sprite_t) * nb_sprites);
+
+	for(i = 0; i < nb_sprites; i++)
+		sprite_order[i] = i;
+
+	nb_sprites_allocated = nb_sprites;
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+// set the image of a sprite. key_color = -1 for a rectangular sprite
+uvga_error_t uVGA::setSprite(int n, const uint8_t *bitmap, int width, int height, int key_color)
+{
+	return sprite_set_image(n, bitmap, width, height, key_color, false);
+}
+
+// RLE sprite created by uvga_rle_encode()
+uvga_error_t uVGA::setSpriteRLE(int n, const uint8_t *rle)
+{
+	return sprite_set_image(n, rle, uvga_rle_width(rle), uvga_rle_height(rle), -1, true);
+}
+
+// ============================================================================
+uvga_error_t uVGA::sprite_set_image(int n, const uint8_t *bitmap, int width, int height, int key_color, bool rle)
+{
+	uvga_sprite_t *s;
+	uint8_t *save;
+
+	if((n < 0) || (n >= nb_sprites_allocated) || (width <= 0) || (height <= 0))
+		return UVGA_OK;
+
+	s = &sprites[n];
+
+	// backing store: 1 byte per pixel, whatever the color mode
+	if((width * height) > s->save_size)
+	{
+		save = (uint8_t *) malloc(width * height);
+		if(save == NULL)
+			return UVGA_FAIL_TO_ALLOCATE_SPRITES;
+
+		// the saved area is restored by the next updateSprites(), keep it
+		if(s->save != NULL)
+		{
+			if(s->saved)
+				memcpy(save, s->save, s->save_size);
+
+			free(s->save);
+		}
+
+		s->save = save;
+		s->save_size = width * height;
+	}
+
+	s->bitmap = bitmap;
+	s->w = width;
+	s->h = height;
+	s->key_color = key_color;
+	s->rle = rle;
+	s->modified = true;
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+void uVGA::moveSprite(int n, int x, int y)
+{
+	if((n < 0) || (n >= nb_sprites_allocated))
+		return;
+
+	if((sprites[n].x != x) || (sprites[n].y != y))
+	{
+		sprites[n].x = x;
+		sprites[n].y = y;
+		sprites[n].modified = true;
+	}
+}
+
+void uVGA::showSprite(int n, bool visible)
+{
+	if((n < 0) || (n >= nb_sprites_allocated) || (sprites[n].bitmap == NULL))
+		return;
+
+	if(sprites[n].visible != visible)
+	{
+		sprites[n].visible = visible;
+		sprites[n].modified = true;
+	}
+}
+
+// ============================================================================
+// sprites with higher z are drawn over sprites with lower z
+void uVGA::setSpriteZ(int n, int z)
+{
+	int i, j;
+	short t;
+
+	if((n < 0) || (n >= nb_sprites_allocated))
+		return;
+
+	sprites[n].z = z;
+	sprites[n].modified = true;
+
+	// insertion sort of drawing order (few sprites, almost sorted)
+	for(i = 1; i < nb_sprites_allocated; i++)
+	{
+		t = sprite_order[i];
+		for(j = i; (j > 0) && (sprites[sprite_order[j - 1]].z > sprites[t].z); j--)
+			sprite_order[j] = sprite_order[j - 1];
+		sprite_order[j] = t;
+	}
+}
+
+// ============================================================================
+// restore the scene under all sprites. Drawing functions can then modify the scene, updateSprites() will draw sprites again
+void uVGA::eraseSprites()
+{
+	int i;
+	uvga_sprite_t *s;
+
+	// reverse drawing order: overlapping sprites restore the scene correctly
+	for(i = nb_sprites_allocated - 1; i >= 0; i--)
+	{
+		s = &sprites[sprite_order[i]];
+
+		if(s->saved)
+		{
+			sprite_copy_area(s, false);
+			s->saved = false;
+		}
+	}
+}
+
+// ============================================================================
+// wait for vertical blanking, restore the scene then draw visible sprites at their new position
+void uVGA::updateSprites()
+{
+	int i;
+	bool modified = false;
+	uvga_sprite_t *s;
+	uvga_rect_t r;
+
+	sprite_nb_dirty_rects = 0;
+
+	for(i = 0; i < nb_sprites_allocated; i++)
+		modified |= sprites[i].modified;
+
+	if(!modified)
+	{
+		// sprites may have been erased by eraseSprites()
+		for(i = 0; i < nb_sprites_allocated; i++)
+		{
+			if(sprites[i].visible && !sprites[i].saved)
+				modified = true;
+		}
+
+		if(!modified)
+			return;
+	}
+
+	waitBeam();
+
+	// old positions
+	for(i = 0; i < nb_sprites_allocated; i++)
+	{
+		if(sprites[i].saved)
+			sprite_dirty_rects[sprite_nb_dirty_rects++] = sprites[i].saved_rect;
+	}
+
+	eraseSprites();
+
+	for(i = 0; i < nb_sprites_allocated; i++)
+	{
+		s = &sprites[sprite_order[i]];
+		s->modified = false;
+
+		if((!s->visible) || (!sprite_clip(&r, s->x, s->y, s->w, s->h, fb_width, fb_height)))
+			continue;
+
+		s->saved_rect = r;
+		sprite_copy_area(s, true);
+		s->saved = true;
+
+		sprite_dirty_rects[sprite_nb_dirty_rects++] = r;
+
+		if(s->rle)
+			drawSprite(s->x, s->y, s->bitmap);
+		else if(s->key_color < 0)
+			drawBitmap(s->x, s->y, (uint8_t *)s->bitmap, s->w, s->h);
+		else
+			drawBitmapKey(s->x, s->y, s->bitmap, s->w, s->h, s->key_color);
+	}
+}
+
+// ============================================================================
+// rectangles modified by the last updateSprites() (old and new position of sprites)
+int uVGA::getSpriteDirtyRects(const uvga_rect_t **rects)
+{
+	*rects = sprite_dirty_rects;
+	return sprite_nb_dirty_rects;
+}
@@ -0,0 +1,620 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// ANSI/VT100 terminal
+
+// When the terminal is enabled, write() parses escape sequences. The screen is the print window, one character per cell of font_width x font_height pixels.
+// Scrolling regions, line and character insertion/deletion move whole areas (pixel copy or text mode cells), characters are never redrawn one by one.
+
+// parser states
+#define UVGA_TERM_NORMAL		0
+#define UVGA_TERM_ESC			1		// after ESC
+#define UVGA_TERM_CSI			2		// after ESC [
+#define UVGA_TERM_OSC			3		// after ESC ], until BEL or ESC
+
+// ANSI colors in RGB332: black, red, green, yellow, blue, magenta, cyan, white then their bright version
+static const uint8_t term_ansi_colors[16] = {
+																0x00, 0xA0, 0x14, 0xB4, 0x02, 0xA2, 0x16, 0xB6,
+																0x49, 0xE0, 0x1C, 0xFC, 0x03, 0xE3, 0x1F, 0xFF
+															};
+
+// ============================================================================
+// RGB332 color of a 256 colors xterm index
+static uint8_t term_xterm_color(int n)
+{
+	int r, g, b;
+
+	if(n < 16)
+		return term_ansi_colors[n];
+
+	// gray ramp
+	if(n >= 232)
+	{
+		n = ((n - 232) * 255) / 23;
+		return (n & 0xE0) | ((n >> 3) & 0x1C) | (n >> 6);
+	}
+
+	// 6x6x6 cube
+	n -= 16;
+	r = n / 36;
+	g = (n / 6) % 6;
+	b = n % 6;
+
+	return ((r * 7 / 5) << 5) | ((g * 7 / 5) << 2) | (b * 3 / 5);
+}
+
+// ============================================================================
+// enable or disable escape sequences parsing by write()
+void uVGA::enableTerminal(bool enable)
+{
+	term_enabled = enable;
+	term_state = UVGA_TERM_NORMAL;
+
+	if(!enable)
+		return;
+
+	term_default_fg = foreground_color;
+	term_default_bg = background_color;
+	term_default_transparent = transparent_background;
+	term_reset();
+}
+
+// ============================================================================
+// back to the state of enableTerminal(), the screen is not modified
+void uVGA::term_reset()
+{
+	term_top = 0;
+	term_bottom = print_window_h - 1;
+	term_saved_x = 0;
+	term_saved_y = 0;
+	term_fg = -1;
+	term_bg = -1;
+	term_bold = false;
+	term_reverse = false;
+	term_apply_colors();
+}
+
+// ============================================================================
+// compute text colors from SGR attributes
+void uVGA::term_apply_colors()
+{
+	int fg;
+	int bg;
+	int t;
+
+	// foreground: default, ANSI index (bold selects the bright version) or direct RGB332 color (+ 256)
+	if(term_fg < 0)
+		fg = term_default_fg;
+	else if(term_fg < 256)
+		fg = term_ansi_colors[((term_fg < 8) && term_bold) ? term_fg + 8 : term_fg];
+	else
+		fg = term_fg - 256;
+
+	if(term_bg < 0)
+		bg = term_default_bg;
+	else if(term_bg < 256)
+		bg = term_ansi_colors[term_bg];
+	else
+		bg = term_bg - 256;
+
+	if(term_reverse)
+	{
+		t = fg;
+		fg = bg;
+		bg = t;
+	}
+
+	foreground_color = fg;
+	background_color = bg;
+
+	// default background keeps the transparency of the print window
+	transparent_background = (term_bg < 0) && !term_reverse && term_default_transparent;
+}
+
+// ============================================================================
+// the scrolling region must stay inside the print window, which can change at any time
+inline void uVGA::term_check_region()
+{
+	if((term_bottom >= print_window_h) || (term_top >= term_bottom))
+	{
+		term_top = 0;
+		term_bottom = print_window_h - 1;
+	}
+
+	if(cursor_y >= print_window_h)
+		cursor_y = print_window_h - 1;
+}
+
+// ============================================================================
+// n-th CSI parameter, def if missing or 0
+inline int uVGA::term_param(int n, int def)
+{
+	if((n >= term_nb_params) || (term_params[n] == 0))
+		return def;
+
+	return term_params[n];
+}
+
+// ============================================================================
+// move cursor one line down, scroll the region if the cursor is on its last line
+void uVGA::term_line_feed()
+{
+	term_check_region();
+
+	if(cursor_y == term_bottom)
+		scroll_print_window_region(term_top, term_bottom, 1);
+	else if(cursor_y < (print_window_h - 1))
+		cursor_y++;
+}
+
+// ============================================================================
+// move cursor one line up, scroll the region down if the cursor is on its first line
+void uVGA::term_reverse_line_feed()
+{
+	term_check_region();
+
+	if(cursor_y == term_top)
+		scroll_print_window_region(term_top, term_bottom, -1);
+	else if(cursor_y > 0)
+		cursor_y--;
+}
+
+// ============================================================================
+// draw n printable characters at cursor position, wrap at the end of the line
+void uVGA::term_put_chars(const uint8_t *text, int n)
+{
+	int i;
+	int nb;
+
+	while(n > 0)
+	{
+		// the cursor stays after the last column until the next character (deferred wrap)
+		if(cursor_x >= print_window_w)
+		{
+			cursor_x = 0;
+			term_line_feed();
+		}
+
+		nb = print_window_w - cursor_x;
+		if(nb > n)
+			nb = n;
+
+		if(text_cells != NULL)
+		{
+			for(i = 0; i < nb; i++)
+				text_set_cell(cursor_x + i, cursor_y, text[i], foreground_color, transparent_background ? -1 : background_color);
+		}
+		else if(font->widths != NULL)
+		{
+			// proportional font: 1 character per cell
+			erase_print_window_chars(cursor_y, cursor_x, cursor_x + nb - 1);
+			for(i = 0; i < nb; i++)
+				drawChar(text[i], print_window_x + (cursor_x + i) * font_width, print_window_y + cursor_y * font_height, foreground_color, -1, UVGA_DIR_RIGHT);
+		}
+		else
+			drawTextRun(text, nb, print_window_x + cursor_x * font_width, print_window_y + cursor_y * font_height, foreground_color, transparent_background ? -1 : background_color);
+
+		cursor_x += nb;
+		text += nb;
+		n -= nb;
+	}
+}
+
+// ============================================================================
+// select graphic rendition
+void uVGA::term_sgr()
+{
+	int i;
+	int p;
+
+	if(term_nb_params == 0)
+		term_nb_params = 1;		// ESC [ m = ESC [ 0 m
+
+	for(i = 0; i < term_nb_params; i++)
+	{
+		p = term_params[i];
+
+		if(p == 0)
+		{
+			term_fg = -1;
+			term_bg = -1;
+			term_bold = false;
+			term_reverse = false;
+		}
+		else if(p == 1)
+			term_bold = true;
+		else if(p == 22)
+			term_bold = false;
+		else if(p == 7)
+			term_reverse = true;
+		else if(p == 27)
+			term_reverse = false;
+		else if((p >= 30) && (p <= 37))
+			term_fg = p - 30;
+		else if(p == 39)
+			term_fg = -1;
+		else if((p >= 40) && (p <= 47))
+			term_bg = p - 40;
+		else if(p == 49)
+			term_bg = -1;
+		else if((p >= 90) && (p <= 97))
+			term_fg = p - 90 + 8;
+		else if((p >= 100) && (p <= 107))
+			term_bg = p - 100 + 8;
+		else if((p == 38) || (p == 48))
+		{
+			// 38;5;n (256 colors) or 38;2;r;g;b (true color), converted to RGB332
+			if(((i + 2) < term_nb_params) && (term_params[i + 1] == 5))
+			{
+				if(p == 38)
+					term_fg = 256 + term_xterm_color(term_params[i + 2] & 0xFF);
+				else
+					term_bg = 256 + term_xterm_color(term_params[i + 2] & 0xFF);
+				i += 2;
+			}
+			else if(((i + 4) < term_nb_params) && (term_params[i + 1] == 2))
+			{
+				int c = (term_params[i + 2] & 0xE0) | ((term_params[i + 3] >> 3) & 0x1C) | ((term_params[i + 4] >> 6) & 0x03);
+
+				if(p == 38)
+					term_fg = 256 + c;
+				else
+					term_bg = 256 + c;
+				i += 4;
+			}
+		}
+	}
+
+	term_apply_colors();
+}
+
+// ============================================================================
+// execute a control sequence
+void uVGA::term_csi(uint8_t c)
+{
+	int n;
+
+	if(cursor_x > print_window_w)
+		cursor_x = print_window_w;
+
+	// private sequences (ESC [ ? ...) are not supported
+	if(term_private)
+		return;
+
+	term_check_region();
+
+	n = term_param(0, 1);
+
+	switch(c)
+	{
+		case 'A':		// cursor up, stops at the top of the scrolling region
+						if((cursor_y >= term_top) && ((cursor_y - n) < term_top))
+							cursor_y = term_top;
+						else
+							cursor_y = (cursor_y < n) ? 0 : cursor_y - n;
+						break;
+
+		case 'B':		// cursor down, stops at the bottom of the scrolling region
+						if((cursor_y <= term_bottom) && ((cursor_y + n) > term_bottom))
+							cursor_y = term_bottom;
+						else if((cursor_y + n) >= print_window_h)
+							cursor_y = print_window_h - 1;
+						else
+							cursor_y += n;
+						break;
+
+		case 'C':		// cursor right
+						cursor_x = ((cursor_x + n) >= print_window_w) ? print_window_w - 1 : cursor_x + n;
+						break;
+
+		case 'D':		// cursor left
+						if(cursor_x >= print_window_w)
+							cursor_x = print_window_w - 1;
+						cursor_x = (cursor_x < n) ? 0 : cursor_x - n;
+						break;
+
+		case 'E':		// cursor next line
+						cursor_y = ((cursor_y + n) >= print_window_h) ? print_window_h - 1 : cursor_y + n;
+						cursor_x = 0;
+						break;
+
+		case 'F':		// cursor previous line
+						cursor_y = (cursor_y < n) ? 0 : cursor_y - n;
+						cursor_x = 0;
+						break;
+
+		case 'G':		// cursor column
+						moveCursor(n - 1, cursor_y);
+						break;
+
+		case 'd':		// cursor line
+						moveCursor(cursor_x, n - 1);
+						break;
+
+		case 'H':		// cursor position
+		case 'f':
+						moveCursor(term_param(1, 1) - 1, n - 1);
+						break;
+
+		case 'J':		// erase in display
+						if(cursor_x >= print_window_w)
+							cursor_x = print_window_w - 1;
+
+						switch(term_param(0, 0))
+						{
+							case 0:
+										erase_print_window_chars(cursor_y, cursor_x, print_window_w - 1);
+										erase_print_window_lines(cursor_y + 1, print_window_h - 1);
+										break;
+							case 1:
+										erase_print_window_lines(0, cursor_y - 1);
+										erase_print_window_chars(cursor_y, 0, cursor_x);
+										break;
+							default:
+										erase_print_window_lines(0, print_window_h - 1);
+										break;
+						}
+						break;
+
+		case 'K':		// erase in line
+						if(cursor_x >= print_window_w)
+							cursor_x = print_window_w - 1;
+
+						switch(term_param(0, 0))
+						{
+							case 0:
+										erase_print_window_chars(cursor_y, cursor_x, print_window_w - 1);
+										break;
+							case 1:
+										erase_print_window_chars(cursor_y, 0, cursor_x);
+										break;
+							default:
+										erase_print_window_chars(cursor_y, 0, print_window_w - 1);
+										break;
+						}
+						break;
+
+		case 'X':		// erase characters
+						if(cursor_x < print_window_w)
+							erase_print_window_chars(cursor_y, cursor_x, ((cursor_x + n) > print_window_w) ? print_window_w - 1 : cursor_x + n - 1);
+						break;
+
+		case 'L':		// insert lines, inside the scrolling region only
+						if((cursor_y >= term_top) && (cursor_y <= term_bottom))
+						{
+							scroll_print_window_region(cursor_y, term_bottom, -n);
+							cursor_x = 0;
+						}
+						break;
+
+		case 'M':		// delete lines, inside the scrolling region only
+						if((cursor_y >= term_top) && (cursor_y <= term_bottom))
+						{
+							scroll_print_window_region(cursor_y, term_bottom, n);
+							cursor_x = 0;
+						}
+						break;
+
+		case '@':		// insert characters
+						if(cursor_x < print_window_w)
+							shift_print_window_chars(cursor_y, cursor_x, n);
+						break;
+
+		case 'P':		// delete characters
+						if(cursor_x < print_window_w)
+							shift_print_window_chars(cursor_y, cursor_x, -n);
+						break;
+
+		case 'S':		// scroll up
+						scroll_print_window_region(term_top, term_bottom, n);
+						break;
+
+		case 'T':		// scroll down
+						scroll_print_window_region(term_top, term_bottom, -n);
+						break;
+
+		case 'm':
+						term_sgr();
+						break;
+
+		case 'r':		// set scrolling region, cursor goes home
+						term_top = term_param(0, 1) - 1;
+						term_bottom = term_param(1, print_window_h) - 1;
+						term_check_region();
+						moveCursor(0, 0);
+						break;
+
+		case 's':
+						term_saved_x = cursor_x;
+						term_saved_y = cursor_y;
+						break;
+
+		case 'u':
+						moveCursor(term_saved_x, term_saved_y);
+						break;
+
+		default:
+						break;
+	}
+}
+
+// ============================================================================
+// parse one character
+size_t uVGA::terminal_write(uint8_t c)
+{
+	switch(term_state)
+	{
+		case UVGA_TERM_NORMAL:
+						switch(c)
+						{
+							case 0x1B:
+											term_state = UVGA_TERM_ESC;
+											break;
+
+							case '\r':
+											cursor_x = 0;
+											break;
+
+							case '\n':
+							case 0x0B:
+							case 0x0C:
+											term_line_feed();
+											break;
+
+							case '\b':
+											if(cursor_x >= print_window_w)
+												cursor_x = print_window_w - 1;
+											if(cursor_x > 0)
+												cursor_x--;
+											break;
+
+							case '\t':
+											cursor_x = (cursor_x | 7) + 1;
+											if(cursor_x >= print_window_w)
+												cursor_x = print_window_w - 1;
+											break;
+
+							default:
+											// other control characters (BEL...) are ignored
+											if((c >= 0x20) && (c != 0x7F))
+												term_put_chars(&c, 1);
+											break;
+						}
+						break;
+
+		case UVGA_TERM_ESC:
+						term_state = UVGA_TERM_NORMAL;
+
+						switch(c)
+						{
+							case '[':
+											term_state = UVGA_TERM_CSI;
+											term_nb_params = 0;
+											term_params[0] = 0;
+											term_private = false;
+											break;
+
+							case ']':
+											term_state = UVGA_TERM_OSC;
+											break;
+
+							case '7':		// save cursor
+											term_saved_x = cursor_x;
+											term_saved_y = cursor_y;
+											break;
+
+							case '8':		// restore cursor
+											moveCursor(term_saved_x, term_saved_y);
+											break;
+
+							case 'D':		// index
+											term_line_feed();
+											break;
+
+							case 'E':		// next line
+											cursor_x = 0;
+											term_line_feed();
+											break;
+
+							case 'M':		// reverse index
+											term_reverse_line_feed();
+											break;
+
+							case 'c':		// reset
+											term_reset();
+											break;
+
+							default:
+											break;
+						}
+						break;
+
+		case UVGA_TERM_CSI:
+						if((c >= '0') && (c <= '9'))
+						{
+							if(term_nb_params == 0)
+								term_nb_params = 1;
+
+							if(term_params[term_nb_params - 1] < 10000)
+								term_params[term_nb_params - 1] = term_params[term_nb_params - 1] * 10 + (c - '0');
+						}
+						else if(c == ';')
+						{
+							if(term_nb_params == 0)
+								term_nb_params = 1;
+
+							if(term_nb_params < UVGA_TERM_MAX_PARAMS)
+								term_params[term_nb_params++] = 0;
+						}
+						else if((c == '?') || (c == '>') || (c == '='))
+							term_private = true;
+						else if((c >= 0x40) && (c <= 0x7E))
+						{
+							term_state = UVGA_TERM_NORMAL;
+							term_csi(c);
+						}
+						else if(c == 0x1B)
+							term_state = UVGA_TERM_ESC;
+						else if((c == 0x18) || (c == 0x1A))		// CAN, SUB: sequence is aborted
+							term_state = UVGA_TERM_NORMAL;
+						break;
+
+		default:
+						// operating system command (window title...) is ignored until BEL or ST (ESC \)
+						if(c == 0x07)
+							term_state = UVGA_TERM_NORMAL;
+						else if(c == 0x1B)
+							term_state = UVGA_TERM_ESC;
+						break;
+	}
+
+	return 1;
+}
+
+// ============================================================================
+// parse a buffer, printable characters between control characters are drawn together
+size_t uVGA::terminal_write(const uint8_t *buffer, size_t size)
+{
+	size_t i;
+	size_t n;
+
+	i = 0;
+	while(i < size)
+	{
+		if(term_state == UVGA_TERM_NORMAL)
+		{
+			for(n = 0; ((i + n) < size) && (buffer[i + n] >= 0x20) && (buffer[i + n] != 0x7F); n++);
+
+			if(n > 0)
+			{
+				term_put_chars(buffer + i, n);
+				i += n;
+				continue;
+			}
+		}
+
+		terminal_write(buffer[i++]);
+	}
+
+	return size;
+}
@@ -0,0 +1,361 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Text mode
+
+// The print window is backed by a grid of cells (character + colors). write(), clearPrintWindow() and scrollPrintWindow()
+// only modify the grid and mark modified cells as dirty. updateTextMode() waits for vertical blanking and draws dirty cells only.
+
+// Grid lines are a ring: scrolling moves the first line index instead of moving pixels. Dirty flags are indexed by screen position,
+// after a scroll, a cell is dirty only if its new content differs from the content displayed at the same position.
+
+// ============================================================================
+// true if 2 cells are displayed the same way
+static inline bool text_cell_equal(const uvga_text_cell_t *a, const uvga_text_cell_t *b)
+{
+	return (a->c == b->c) && (a->fg == b->fg) && (a->bg == b->bg) && (a->attr == b->attr);
+}
+
+// ============================================================================
+// cell of the grid at a screen position
+inline uvga_text_cell_t *uVGA::text_cell(int column, int line)
+{
+	line += text_first_line;
+	if(line >= text_h)
+		line -= text_h;
+
+	return &text_cells[line * text_w + column];
+}
+
+// ============================================================================
+inline void uVGA::text_mark_dirty(int column, int line)
+{
+	int n = line * text_w + column;
+
+	if((text_dirty[n >> 5] & (1 << (n & 31))) == 0)
+	{
+		text_dirty[n >> 5] |= (1 << (n & 31));
+		text_nb_dirty++;
+	}
+}
+
+// ============================================================================
+// modify a cell, it becomes dirty only if its content changes
+void uVGA::text_set_cell(int column, int line, uint8_t c, uint8_t fg, int bg)
+{
+	uvga_text_cell_t cell;
+	uvga_text_cell_t *cur;
+
+	cell.c = c;
+	cell.fg = fg;
+	cell.bg = (bg == -1) ? 0 : bg;
+	cell.attr = (bg == -1) ? UVGA_TEXT_ATTR_TRANSPARENT : 0;
+
+	cur = text_cell(column, line);
+
+	if(!text_cell_equal(cur, &cell))
+	{
+		*cur = cell;
+		text_mark_dirty(column, line);
+	}
+}
+
+// ============================================================================
+// create the cell grid of the current print window. All cells are blank and dirty
+uvga_error_t uVGA::enableTextMode()
+{
+	int n;
+	int nb_words;
+
+	disableTextMode();
+
+	text_w = print_window_w;
+	text_h = print_window_h;
+	text_first_line = 0;
+
+	n = text_w * text_h;
+	nb_words = (n + 31) >> 5;
+
+	text_cells = (uvga_text_cell_t *) malloc(sizeof(uvga_text_cell_t) * n);
+	text_dirty = (uint32_t *) malloc(sizeof(uint32_t) * nb_words);
+
+	if((text_cells == NULL) || (text_dirty == NULL))
+	{
+		disableTextMode();
+		return UVGA_FAIL_TO_ALLOCATE_TEXT_GRID;
+	}
+
+	while(n--)
+	{
+		text_cells[n].c = ' ';
+		text_cells[n].fg = foreground_color;
+		text_cells[n].bg = background_color;
+		text_cells[n].attr = transparent_background ? UVGA_TEXT_ATTR_TRANSPARENT : 0;
+	}
+
+	memset(text_dirty, 0xFF, sizeof(uint32_t) * nb_words);
+	text_nb_dirty = text_w * text_h;
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+// back to immediate drawing, the content of the screen is kept
+void uVGA::disableTextMode()
+{
+	if(text_cells != NULL)
+		free(text_cells);
+
+	if(text_dirty != NULL)
+		free(text_dirty);
+
+	text_cells = NULL;
+	text_dirty = NULL;
+	text_nb_dirty = 0;
+}
+
+// ============================================================================
+// wait for vertical blanking and draw dirty cells
+void uVGA::updateTextMode()
+{
+	int w;
+	int n;
+	int b;
+	uint32_t bits;
+	uvga_text_cell_t *cell;
+	int column;
+	int line;
+	int x;
+	int y;
+	int advance;
+
+	if((text_cells == NULL) || (text_nb_dirty == 0))
+		return;
+
+	waitBeam();
+
+	for(w = 0; w < ((text_w * text_h + 31) >> 5); w++)
+	{
+		if((bits = text_dirty[w]) == 0)
+			continue;
+
+		text_dirty[w] = 0;
+
+		while(bits)
+		{
+			b = __builtin_ctz(bits);
+			bits &= bits - 1;
+
+			n = (w << 5) + b;
+			line = n / text_w;
+			column = n - line * text_w;
+
+			cell = text_cell(column, line);
+			x = print_window_x + column * font_width;
+			y = print_window_y + line * font_height;
+
+			// transparent cell: the previous glyph is removed by drawing the background behind the print window
+			if(cell->attr & UVGA_TEXT_ATTR_TRANSPARENT)
+			{
+				if(text_erase_callback != NULL)
+					text_erase_callback(x, y, font_width, font_height);
+				else
+					fillRect(x, y, x + font_width - 1, y + font_height - 1, text_erase_color);
+			}
+
+			advance = drawChar(cell->c, x, y, cell->fg, (cell->attr & UVGA_TEXT_ATTR_TRANSPARENT) ? -1 : cell->bg, UVGA_DIR_RIGHT);
+
+			// proportional font: the end of the cell is background
+			if((advance < font_width) && ((cell->attr & UVGA_TEXT_ATTR_TRANSPARENT) == 0))
+				fillRect(x + advance, y, x + font_width - 1, y + font_height - 1, cell->bg);
+		}
+	}
+
+	text_nb_dirty = 0;
+}
+
+// ============================================================================
+// write a character in a cell. Cursor is not moved
+void uVGA::setTextCell(int column, int line, uint8_t c, uint8_t fg_col, int bg_col)
+{
+	if((text_cells == NULL) || (column < 0) || (column >= text_w) || (line < 0) || (line >= text_h))
+		return;
+
+	text_set_cell(column, line, c, fg_col, bg_col);
+}
+
+// ============================================================================
+// background of transparent cells, used by updateTextMode() to erase their previous glyph
+void uVGA::setTextModeErase(uvga_text_erase_callback_t callback, uint8_t color)
+{
+	text_erase_callback = callback;
+	text_erase_color = color;
+}
+
+// ============================================================================
+// move all lines one line up, the last line becomes blank
+void uVGA::text_scroll()
+{
+	int column;
+	int line;
+	uvga_text_cell_t *cur;
+	uvga_text_cell_t *next;
+	uvga_text_cell_t blank;
+
+	blank.c = ' ';
+	blank.fg = foreground_color;
+	blank.bg = transparent_background ? 0 : background_color;
+	blank.attr = transparent_background ? UVGA_TEXT_ATTR_TRANSPARENT : 0;
+
+	// displayed line 'line' will show grid line 'line + 1'. It must be redrawn if it is already dirty or if both lines differ
+	for(line = 0; line < (text_h - 1); line++)
+	{
+		cur = text_cell(0, line);
+		next = text_cell(0, line + 1);
+
+		for(column = 0; column < text_w; column++)
+		{
+			if(!text_cell_equal(&cur[column], &next[column]))
+				text_mark_dirty(column, line);
+		}
+	}
+
+	// the last displayed line will be blank
+	cur = text_cell(0, text_h - 1);
+	for(column = 0; column < text_w; column++)
+	{
+		if(!text_cell_equal(&cur[column], &blank))
+			text_mark_dirty(column, text_h - 1);
+	}
+
+	// the first grid line becomes the last one
+	text_first_line++;
+	if(text_first_line >= text_h)
+		text_first_line = 0;
+
+	cur = text_cell(0, text_h - 1);
+	for(column = 0; column < text_w; column++)
+		cur[column] = blank;
+}
+
+// ============================================================================
+// fill the grid with blank cells
+void uVGA::text_clear()
+{
+	int column;
+	int line;
+
+	for(line = 0; line < text_h; line++)
+	{
+		for(column = 0; column < text_w; column++)
+			text_set_cell(column, line, ' ', foreground_color, transparent_background ? -1 : background_color);
+	}
+}
+
+// ============================================================================
+// move lines top to bottom nb_lines lines up (nb_lines > 0) or down (nb_lines < 0), vacated lines are blank
+// cells are copied, only cells whose content changes become dirty
+void uVGA::text_scroll_region(int top, int bottom, int nb_lines)
+{
+	int line;
+	int src;
+	int column;
+	uvga_text_cell_t *cell;
+
+	if(nb_lines > 0)
+	{
+		for(line = top; line <= bottom; line++)
+		{
+			src = line + nb_lines;
+
+			for(column = 0; column < text_w; column++)
+			{
+				if(src <= bottom)
+				{
+					cell = text_cell(column, src);
+					text_set_cell(column, line, cell->c, cell->fg, (cell->attr & UVGA_TEXT_ATTR_TRANSPARENT) ? -1 : cell->bg);
+				}
+				else
+					text_set_cell(column, line, ' ', foreground_color, transparent_background ? -1 : background_color);
+			}
+		}
+	}
+	else
+	{
+		for(line = bottom; line >= top; line--)
+		{
+			src = line + nb_lines;
+
+			for(column = 0; column < text_w; column++)
+			{
+				if(src >= top)
+				{
+					cell = text_cell(column, src);
+					text_set_cell(column, line, cell->c, cell->fg, (cell->attr & UVGA_TEXT_ATTR_TRANSPARENT) ? -1 : cell->bg);
+				}
+				else
+					text_set_cell(column, line, ' ', foreground_color, transparent_background ? -1 : background_color);
+			}
+		}
+	}
+}
+
+// ============================================================================
+// move cells from column to the end of the line nb_chars columns right (nb_chars > 0) or left (nb_chars < 0), vacated cells are blank
+void uVGA::text_shift_line(int line, int column, int nb_chars)
+{
+	int c;
+	int src;
+	uvga_text_cell_t *cell;
+
+	if(nb_chars > 0)
+	{
+		for(c = text_w - 1; c >= column; c--)
+		{
+			src = c - nb_chars;
+
+			if(src >= column)
+			{
+				cell = text_cell(src, line);
+				text_set_cell(c, line, cell->c, cell->fg, (cell->attr & UVGA_TEXT_ATTR_TRANSPARENT) ? -1 : cell->bg);
+			}
+			else
+				text_set_cell(c, line, ' ', foreground_color, transparent_background ? -1 : background_color);
+		}
+	}
+	else
+	{
+		for(c = column; c < text_w; c++)
+		{
+			src = c - nb_chars;
+
+			if(src < text_w)
+			{
+				cell = text_cell(src, line);
+				text_set_cell(c, line, cell->c, cell->fg, (cell->attr & UVGA_TEXT_ATTR_TRANSPARENT) ? -1 : cell->bg);
+			}
+			else
+				text_set_cell(c, line, ' ', foreground_color, transparent_background ? -1 : background_color);
+		}
+	}
+}
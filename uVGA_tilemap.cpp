@@ -0,0 +1,391 @@
+/*
+	This file is part of uVGA library.
+
+	uVGA library is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	uVGA library is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with uVGA library.  If not, see <http://www.gnu.org/licenses/>.
+
+	Copyright (C) 2017 Eric PREVOTEAU
+
+	Original Author: Eric PREVOTEAU <digital.or@gmail.com>
+*/
+
+#include "uVGA.h"
+
+// Tile map layer
+
+// A rectangular area of the frame buffer (the layer window) displays a map of tile indexes. Tiles are tile_w x tile_h bitmaps
+// (1 byte per pixel, same format as drawBitmap()). The map wraps around in both directions.
+
+// renderTileMap() only draws what changed since the previous call:
+// - when the scroll position changed, the content of the window is moved with row copies, only the areas scrolled into view are drawn,
+// - tiles modified by setTile() are drawn.
+// Pixels are drawn by runs: each run is a part of a tile row, copied at once.
+
+// with UVGA_DMA_LINE_BUFFER and a scanline callback, renderTileMapLine() draws a line of the map directly in the line buffer
+
+// ============================================================================
+// define the tile map layer. The map is not copied, it can be modified with setTile() or directly (then call invalidateTileMap())
+// w or h = -1: the window goes to the right or bottom of the frame buffer
+uvga_error_t uVGA::setTileMap(const uint8_t *tiles, int tile_w, int tile_h, uint8_t *map, int map_w, int map_h, int x, int y, int w, int h)
+{
+	int nb_words;
+
+	if(tm_dirty != NULL)
+	{
+		free(tm_dirty);
+		tm_dirty = NULL;
+	}
+
+	tm_map = NULL;
+
+	if((tiles == NULL) || (map == NULL) || (tile_w <= 0) || (tile_h <= 0) || (map_w <= 0) || (map_h <= 0))
+		return UVGA_OK;
+
+	if(x < 0)
+		x = 0;
+	if(y < 0)
+		y = 0;
+	if((w < 0) || ((x + w) > fb_width))
+		w = fb_width - x;
+	if((h < 0) || ((y + h) > fb_height))
+		h = fb_height - y;
+
+	nb_words = (map_w * map_h + 31) >> 5;
+	tm_dirty = (uint32_t *) malloc(sizeof(uint32_t) * nb_words);
+	if(tm_dirty == NULL)
+		return UVGA_FAIL_TO_ALLOCATE_TILE_MAP;
+
+	memset(tm_dirty, 0, sizeof(uint32_t) * nb_words);
+
+	tm_tiles = tiles;
+	tm_tile_w = tile_w;
+	tm_tile_h = tile_h;
+	tm_map = map;
+	tm_map_w = map_w;
+	tm_map_h = map_h;
+	tm_x = x;
+	tm_y = y;
+	tm_w = w;
+	tm_h = h;
+	tm_sx = 0;
+	tm_sy = 0;
+	tm_drawn_sx = 0;
+	tm_drawn_sy = 0;
+	tm_valid = false;
+	tm_nb_dirty = 0;
+
+	return UVGA_OK;
+}
+
+// ============================================================================
+// modify a tile of the map, it is drawn by the next renderTileMap()
+void uVGA::setTile(int column, int row, uint8_t tile)
+{
+	int n;
+
+	if((tm_map == NULL) || (column < 0) || (column >= tm_map_w) || (row < 0) || (row >= tm_map_h))
+		return;
+
+	n = row * tm_map_w + column;
+
+	if(tm_map[n] == tile)
+		return;
+
+	tm_map[n] = tile;
+
+	if((tm_dirty[n >> 5] & (1 << (n & 31))) == 0)
+	{
+		tm_dirty[n >> 5] |= (1 << (n & 31));
+		tm_nb_dirty++;
+	}
+}
+
+uint8_t uVGA::getTile(int column, int row)
+{
+	if((tm_map == NULL) || (column < 0) || (column >= tm_map_w) || (row < 0) || (row >= tm_map_h))
+		return 0;
+
+	return tm_map[row * tm_map_w + column];
+}
+
+// ============================================================================
+// position in the map (in pixels) of the top left pixel of the window
+void uVGA::setTileMapScroll(int x, int y)
+{
+	int mw = tm_map_w * tm_tile_w;
+	int mh = tm_map_h * tm_tile_h;
+
+	if(tm_map == NULL)
+		return;
+
+	x %= mw;
+	if(x < 0)
+		x += mw;
+
+	y %= mh;
+	if(y < 0)
+		y += mh;
+
+	tm_sx = x;
+	tm_sy = y;
+}
+
+// ============================================================================
+// the whole window is drawn by the next renderTileMap()
+void uVGA::invalidateTileMap()
+{
+	tm_valid = false;
+}
+
+// ============================================================================
+// draw window pixels x0 to x1 of window line y in dst (dst is the pixel x0). RGB332 only
+void uVGA::tilemap_render_row(uint8_t *dst, int y, int x0, int x1)
+{
+	int mw = tm_map_w * tm_tile_w;
+	int mx, my;
+	int tx, ty;
+	int run;
+	const uint8_t *map_row;
+	const uint8_t *tile_row;
+	int tile_size = tm_tile_w * tm_tile_h;
+
+	my = (tm_sy + y) % (tm_map_h * tm_tile_h);
+	ty = my % tm_tile_h;
+	map_row = tm_map + (my / tm_tile_h) * tm_map_w;
+	tile_row = tm_tiles + ty * tm_tile_w;
+
+	mx = (tm_sx + x0) % mw;
+
+	while(x0 <= x1)
+	{
+		tx = mx % tm_tile_w;
+
+		// until the end of the tile or the end of the area
+		run = tm_tile_w - tx;
+		if(run > (x1 - x0 + 1))
+			run = x1 - x0 + 1;
+
+		memcpy(dst, tile_row + map_row[mx / tm_tile_w] * tile_size + tx, run);
+
+		dst += run;
+		x0 += run;
+		mx += run;
+		if(mx >= mw)
+			mx = 0;
+	}
+}
+
+// ============================================================================
+// draw a rectangle of the window (window coordinates, clipped to the window)
+void uVGA::tilemap_render_area(int x0, int y0, int x1, int y1)
+{
+	int x, y;
+	int mw = tm_map_w * tm_tile_w;
+	int mh = tm_map_h * tm_tile_h;
+	int mx, my;
+	const uint8_t *tile;
+
+	if(x0 < 0)
+		x0 = 0;
+	if(y0 < 0)
+		y0 = 0;
+	if(x1 >= tm_w)
+		x1 = tm_w - 1;
+	if(y1 >= tm_h)
+		y1 = tm_h - 1;
+
+	if((x0 > x1) || (y0 > y1))
+		return;
+
+	dirty_mark(tm_x + x0, tm_y + y0, tm_x + x1, tm_y + y1);
+
+	for(y = y0; y <= y1; y++)
+	{
+		if(fb_bpp == 8)
+		{
+			tilemap_render_row(frame_buffer + (tm_y + y) * fb_row_stride + tm_x + x0, y, x0, x1);
+			continue;
+		}
+
+		// packed pixels: tiles contain palette indexes
+		my = (tm_sy + y) % mh;
+
+		for(x = x0; x <= x1; x++)
+		{
+			mx = (tm_sx + x) % mw;
+			tile = tm_tiles + tm_map[(my / tm_tile_h) * tm_map_w + mx / tm_tile_w] * tm_tile_w * tm_tile_h;
+			store_pixel(tm_x + x, tm_y + y, tile[(my % tm_tile_h) * tm_tile_w + mx % tm_tile_w]);
+		}
+	}
+}
+
+// ============================================================================
+// move window content by (-dx,-dy) pixels. RGB332 only, |dx| < tm_w and |dy| < tm_h
+void uVGA::tilemap_move(int dx, int dy)
+{
+	int y;
+	int first, last, step;
+	uint8_t *dst;
+	uint8_t *src;
+	int w = tm_w - ((dx < 0) ? -dx : dx);
+
+	// moving up: first line first, moving down: last line first
+	if(dy >= 0)
+	{
+		first = 0;
+		last = tm_h - dy;
+		step = 1;
+	}
+	else
+	{
+		first = tm_h - 1;
+		last = -dy - 1;
+		step = -1;
+	}
+
+	dirty_mark(tm_x, tm_y, tm_x + tm_w - 1, tm_y + tm_h - 1);
+
+	for(y = first; y != last; y += step)
+	{
+		dst = frame_buffer + (tm_y + y) * fb_row_stride + tm_x;
+		src = frame_buffer + (tm_y + y + dy) * fb_row_stride + tm_x;
+
+		if(dx >= 0)
+			memmove(dst, src + dx, w);
+		else
+			memmove(dst - dx, src, w);
+	}
+}
+
+// ============================================================================
+// draw what changed since the last call
+void uVGA::renderTileMap()
+{
+	int dx, dy;
+	int mw, mh;
+	int w;
+	int b;
+	int n;
+	uint32_t bits;
+	int cx, cy;
+	int x, y;
+
+	if(tm_map == NULL)
+		return;
+
+	mw = tm_map_w * tm_tile_w;
+	mh = tm_map_h * tm_tile_h;
+
+	// shortest scroll movement, the map wraps around
+	dx = tm_sx - tm_drawn_sx;
+	if(dx > (mw / 2))
+		dx -= mw;
+	else if(dx < -(mw / 2))
+		dx += mw;
+
+	dy = tm_sy - tm_drawn_sy;
+	if(dy > (mh / 2))
+		dy -= mh;
+	else if(dy < -(mh / 2))
+		dy += mh;
+
+	wait_gfx_dma_end();
+
+	if((!tm_valid) || (fb_bpp != 8 && (dx || dy)) || (dx >= tm_w) || (-dx >= tm_w) || (dy >= tm_h) || (-dy >= tm_h))
+	{
+		tm_drawn_sx = tm_sx;
+		tm_drawn_sy = tm_sy;
+
+		tilemap_render_area(0, 0, tm_w - 1, tm_h - 1);
+
+		memset(tm_dirty, 0, sizeof(uint32_t) * ((tm_map_w * tm_map_h + 31) >> 5));
+		tm_nb_dirty = 0;
+		tm_valid = true;
+		return;
+	}
+
+	if(dx || dy)
+	{
+		tilemap_move(dx, dy);
+
+		tm_drawn_sx = tm_sx;
+		tm_drawn_sy = tm_sy;
+
+		// areas scrolled into view
+		if(dy > 0)
+			tilemap_render_area(0, tm_h - dy, tm_w - 1, tm_h - 1);
+		else if(dy < 0)
+			tilemap_render_area(0, 0, tm_w - 1, -dy - 1);
+
+		if(dx > 0)
+			tilemap_render_area(tm_w - dx, 0, tm_w - 1, tm_h - 1);
+		else if(dx < 0)
+			tilemap_render_area(0, 0, -dx - 1, tm_h - 1);
+	}
+
+	if(tm_nb_dirty == 0)
+		return;
+
+	// modified tiles, each tile may be visible several times if the window is larger than the map
+	for(w = 0; w < ((tm_map_w * tm_map_h + 31) >> 5); w++)
+	{
+		if((bits = tm_dirty[w]) == 0)
+			continue;
+
+		tm_dirty[w] = 0;
+
+		while(bits)
+		{
+			b = __builtin_ctz(bits);
+			bits &= bits - 1;
+
+			n = (w << 5) + b;
+			cy = n / tm_map_w;
+			cx = n - cy * tm_map_w;
+
+			// first position of the tile in window, possibly partially on the left/top of the window
+			x = (cx * tm_tile_w - tm_sx) % mw;
+			if(x < 0)
+				x += mw;
+			if(x > 0)
+				x -= mw;
+
+			for(; x < tm_w; x += mw)
+			{
+				y = (cy * tm_tile_h - tm_sy) % mh;
+				if(y < 0)
+					y += mh;
+				if(y > 0)
+					y -= mh;
+
+				for(; y < tm_h; y += mh)
+				{
+					if(((x + tm_tile_w) > 0) && ((y + tm_tile_h) > 0))
+						tilemap_render_area(x, y, x + tm_tile_w - 1, y + tm_tile_h - 1);
+				}
+			}
+		}
+	}
+
+	tm_nb_dirty = 0;
+}
+
+// ============================================================================
+// draw a line of the map in a line buffer (RGB332), from a scanline callback. 'row' is a row of the window
+void uVGA::renderTileMapLine(uint8_t *line_buffer, int row, int width)
+{
+	if((tm_map == NULL) || (width <= 0))
+		return;
+
+	tilemap_render_row(line_buffer, row, 0, width - 1);
+}